@@ -113,35 +113,26 @@ elif mode == "Decode":
             with open(stego_image_path_decode, "wb") as f:
                 f.write(stego_image_file_decode.getbuffer())
 
-            # Base name for the output, extension will be added by C++ code
-            output_secret_base_name = "decoded_secret" 
-            output_secret_base_path = os.path.join(OUTPUT_DIR, output_secret_base_name)
-            # The C++ binding will append the correct extension.
-            # We use a unique base to avoid overwrites during the session.
-            output_secret_base_path = get_unique_filename(OUTPUT_DIR, output_secret_base_name + ".tmp")[:-4] # remove .tmp
-
             with st.spinner("Decoding in progress..."):
                 try:
-                    result = steganography_engine.decode(
+                    # Chunks arrive while the engine is still extracting; no output file is written
+                    stream = steganography_engine.decode_stream(
                         stego_image_path_decode,
-                        output_secret_base_path, # Base path for output
                         magic_string_decode
                     )
+                    secret_data = b"".join(stream)
+                    decoded_name = "decoded_secret" + stream.ext
+
+                    st.success(f"✅ Decoding successful! Output: {decoded_name}")
+                    st.download_button(
+                        label="📥 Download Decoded File",
+                        data=secret_data,
+                        file_name=decoded_name
+                        # Mime type is unknown until decoded, so let browser guess or use generic
+                    )
 
-                    if result.success and result.output_path and os.path.exists(result.output_path):
-                        st.success(f"✅ Decoding successful! Output: {os.path.basename(result.output_path)}")
-                        with open(result.output_path, "rb") as file_to_download:
-                            st.download_button(
-                                label="📥 Download Decoded File",
-                                data=file_to_download,
-                                file_name=os.path.basename(result.output_path)
-                                # Mime type is unknown until decoded, so let browser guess or use generic
-                            )
-                    elif result.success and not result.output_path:
-                         st.info("ℹ️ Decoding reported success, but no output path was returned or file does not exist. This might happen if the secret data size was 0.")
-                    else:
-                        st.error(f"❌ Decoding failed: {result.message}")
-
+                except ValueError as e:
+                    st.error(f"❌ Decoding failed: {e}")
                 except Exception as e:
                     st.error(f"An unexpected error occurred during decoding: {e}")
                 finally:
@@ -3,10 +3,26 @@
 #include "common.h"
 #include "encode.h"
 #include "decode.h"
+#include "stripe.h"
+#include "matrix.h"
+#include "daemon.h"
+#include "pool.h"
+#include "archive.h"
+#include "video.h"
 #include <string>
 #include <vector>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
 #include <cstdio>  // For snprintf
 #include <cstring> // For strncpy, strcat, etc.
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#endif
 
 namespace py = pybind11;
 
@@ -15,15 +31,88 @@ struct StegOperationResult {
     bool success;
     std::string message;
     std::string output_path; // For decode, this will be the path to the secret file
+    std::vector<std::string> output_paths; // For striped encode, one stego image per stripe
+    // Filled by encode(verify=True) from the read-back of every embedded block
+    bool verified = false;
+    long mismatches = 0;
+    uint32_t checksum = 0; // CRC-32 of the secret as read back from the stego samples
+    std::string carrier_path; // Carrier picked by CarrierPool.encode
+};
+
+// Shared with a running encode/decode; cancel() stops it at the next block boundary
+class CancelToken {
+public:
+    void cancel() { cancelled_.store(true); }
+    bool cancelled() const { return cancelled_.load(); }
+    std::atomic<bool> *flag() { return &cancelled_; }
+
+private:
+    std::atomic<bool> cancelled_{false};
+};
+
+// Progress/cancellation state of one Python call
+// The engine runs with the GIL released; the GIL is only taken back when
+// StegControl decides a progress report is due (every progress_interval bytes).
+struct PyJobControl {
+    StegControl control;
+    py::object callback;
+    std::atomic<bool> local_cancel{false};
+    std::string callback_error; // Set when the callback raised, which cancels the job
+
+    PyJobControl(py::object progress, long progress_interval, CancelToken *cancel_token)
+        : callback(progress)
+    {
+        memset(&control, 0, sizeof(control));
+        control.progress = callback.is_none() ? nullptr : &PyJobControl::report;
+        control.progress_ctx = this;
+        control.progress_interval = progress_interval;
+        control.cancelled = cancel_token ? cancel_token->flag() : &local_cancel;
+    }
+
+    bool cancelled() const { return control.cancelled->load(); }
+
+    // Failure message for a job that stopped early, empty if it was not cancelled
+    std::string stop_message() const {
+        if (!callback_error.empty()) return "Cancelled: progress callback raised " + callback_error;
+        return cancelled() ? "Cancelled." : "";
+    }
+
+    static void report(void *ctx, long done, long total) {
+        PyJobControl *job = static_cast<PyJobControl *>(ctx);
+        py::gil_scoped_acquire acquire;
+        try {
+            job->callback(done, total);
+        } catch (py::error_already_set &e) {
+            job->callback_error = e.what();
+            job->control.cancelled->store(true);
+        }
+    }
 };
 
 StegOperationResult py_encode(const std::string &src_image_path,
                               const std::string &secret_file_path,
                               const std::string &stego_image_path,
-                              const std::string &magic_string)
+                              const std::string &magic_string,
+                              int matrix_p,
+                              py::object progress,
+                              long progress_interval,
+                              CancelToken *cancel_token,
+                              bool verify)
 {
+    if (matrix_p != 0 && (matrix_p < MATRIX_MIN_P || matrix_p > MATRIX_MAX_P)) {
+        return {false, "matrix_p must be 0 (plain LSB) or between 2 and 8.", ""};
+    }
+    PyJobControl job(progress, progress_interval, cancel_token);
+
     EncodeInfo encInfo;
     memset(&encInfo, 0, sizeof(EncodeInfo)); // Initialize struct
+    encInfo.matrix_p = static_cast<uint8_t>(matrix_p);
+    encInfo.control = &job.control;
+    EmbedVerify verify_info;
+    memset(&verify_info, 0, sizeof(verify_info));
+    if (verify) {
+        encInfo.verify = &verify_info;
+    }
 
     // Pybind11 strings are std::string, C functions need char*.
     // Use .c_str() for read-only, or copy if the C function might modify (not typical for paths).
@@ -50,7 +139,10 @@ StegOperationResult py_encode(const std::string &src_image_path,
     }
 
     // do_encoding now calls check_capacity internally after it has the magic string
-    status = do_encoding(&encInfo, magic_string.c_str());
+    {
+        py::gil_scoped_release release;
+        status = do_encoding(&encInfo, magic_string.c_str());
+    }
 
     // Clean up file pointers
     if (encInfo.fptr_src_image) fclose(encInfo.fptr_src_image);
@@ -65,22 +157,48 @@ StegOperationResult py_encode(const std::string &src_image_path,
 
 
     if (status == e_success) {
-        return {true, "Encoding successful.", stego_image_path};
+        StegOperationResult result = {true, "Encoding successful.", stego_image_path};
+        if (verify) {
+            result.message = "Encoding successful and verified.";
+            result.verified = true;
+            result.checksum = verify_info.checksum;
+        }
+        return result;
     } else {
         // More specific error messages could be propagated from C++ functions
         // For now, a generic failure message.
         // Remove output file if encoding failed to prevent partial/corrupt file
         remove(stego_image_path.c_str()); 
+        if (job.cancelled()) {
+            return {false, job.stop_message(), ""};
+        }
+        if (verify_info.mismatches > 0) {
+            StegOperationResult result = {false, "Verification failed: " + std::to_string(verify_info.mismatches) +
+                                                 " embedded bytes read back differently.", ""};
+            result.mismatches = verify_info.mismatches;
+            return result;
+        }
         return {false, "Encoding failed. Check image capacity and file integrity.", ""};
     }
 }
 
 StegOperationResult py_decode(const std::string &stego_image_path,
                               const std::string &output_secret_base_path, // e.g., "output/decoded_secret" (no ext)
-                              const std::string &magic_string)
+                              const std::string &magic_string,
+                              int matrix_p,
+                              py::object progress,
+                              long progress_interval,
+                              CancelToken *cancel_token)
 {
+    if (matrix_p != 0 && (matrix_p < MATRIX_MIN_P || matrix_p > MATRIX_MAX_P)) {
+        return {false, "matrix_p must be 0 (plain LSB) or between 2 and 8.", ""};
+    }
+    PyJobControl job(progress, progress_interval, cancel_token);
+
     EncodeInfo encInfo;
     memset(&encInfo, 0, sizeof(EncodeInfo));
+    encInfo.matrix_p = static_cast<uint8_t>(matrix_p);
+    encInfo.control = &job.control;
 
     encInfo.stego_image_fname = strdup(stego_image_path.c_str());
     // dest_file path will be constructed after decoding extension
@@ -149,10 +267,10 @@ StegOperationResult py_decode(const std::string &stego_image_path,
 
     std::string final_output_path_str;
 
-    if (fseek(encInfo.fptr_stego_image, 54, SEEK_SET) != 0) {
+    if (skip_carrier_header(&encInfo) == e_failure) {
         fclose(encInfo.fptr_stego_image);
         free(encInfo.stego_image_fname);
-        return {false, "Failed to seek in stego image.", ""};
+        return {false, "Unsupported stego carrier or failed to seek past its header.", ""};
     }
 
     if (extract_magic(&encInfo, magic_string.c_str()) == e_failure) {
@@ -165,7 +283,7 @@ StegOperationResult py_decode(const std::string &stego_image_path,
         fclose(encInfo.fptr_stego_image);
         free(encInfo.stego_image_fname);
         if(encInfo.ext) free(encInfo.ext);
-        return {false, "Failed to decode file extension.", ""};
+        return {false, "Failed to decode file extension, or the secret was embedded with another matrix_p.", ""};
     }
     
     // Now encInfo.ext should be populated. Construct full output path.
@@ -187,7 +305,10 @@ StegOperationResult py_decode(const std::string &stego_image_path,
         return {false, "Failed to open destination file: " + final_output_path_str, ""};
     }
 
-    status = decode_secret_data(&encInfo); // This writes to encInfo.fptr_dest_file
+    {
+        py::gil_scoped_release release;
+        status = decode_secret_data(&encInfo); // This writes to encInfo.fptr_dest_file
+    }
 
     // Clean up
     if (encInfo.fptr_stego_image) fclose(encInfo.fptr_stego_image);
@@ -202,10 +323,665 @@ StegOperationResult py_decode(const std::string &stego_image_path,
     } else {
         remove(final_output_path_c_str); // Remove potentially corrupt output file
         free(final_output_path_c_str);
+        if (job.cancelled()) {
+            return {false, job.stop_message(), ""};
+        }
         return {false, "Decoding failed.", ""};
     }
 }
 
+StegOperationResult py_encode_striped(const std::vector<std::string> &src_image_paths,
+                                      const std::string &secret_file_path,
+                                      const std::vector<std::string> &stego_image_paths,
+                                      const std::string &magic_string)
+{
+    if (src_image_paths.empty() || src_image_paths.size() != stego_image_paths.size()) {
+        return {false, "Striped encoding needs one stego image path per source image.", ""};
+    }
+
+    std::vector<const char *> src_fnames, stego_fnames;
+    for (const auto &path : src_image_paths) src_fnames.push_back(path.c_str());
+    for (const auto &path : stego_image_paths) stego_fnames.push_back(path.c_str());
+
+    Status status;
+    {
+        // Stripes are encoded on worker threads, let other Python threads run meanwhile
+        py::gil_scoped_release release;
+        status = do_striped_encoding(src_fnames.data(), stego_fnames.data(), (int)src_fnames.size(),
+                                     secret_file_path.c_str(), magic_string.c_str());
+    }
+
+    if (status == e_success) {
+        return {true, "Striped encoding successful.", "", stego_image_paths};
+    } else {
+        for (const auto &path : stego_image_paths) remove(path.c_str());
+        return {false, "Striped encoding failed. Check the combined capacity of the source images.", ""};
+    }
+}
+
+StegOperationResult py_decode_striped(const std::vector<std::string> &stego_image_paths,
+                                      const std::string &output_secret_base_path,
+                                      const std::string &magic_string)
+{
+    if (stego_image_paths.empty()) {
+        return {false, "No stego images given for striped decoding.", ""};
+    }
+
+    std::vector<const char *> stego_fnames;
+    for (const auto &path : stego_image_paths) stego_fnames.push_back(path.c_str());
+
+    char *output_path_c_str = nullptr;
+    Status status;
+    {
+        py::gil_scoped_release release;
+        status = do_striped_decoding(stego_fnames.data(), (int)stego_fnames.size(), magic_string.c_str(),
+                                     output_secret_base_path.c_str(), &output_path_c_str);
+    }
+
+    if (status == e_success) {
+        std::string return_path = output_path_c_str;
+        free(output_path_c_str);
+        return {true, "Striped decoding successful.", return_path};
+    } else {
+        return {false, "Striped decoding failed. Check that all stripes and the magic string are present.", ""};
+    }
+}
+
+StegOperationResult py_encode_archive(const std::string &src_image_path,
+                                      const std::vector<std::string> &secret_file_paths,
+                                      const std::string &stego_image_path,
+                                      const std::string &magic_string,
+                                      int matrix_p)
+{
+    if (matrix_p != 0 && (matrix_p < MATRIX_MIN_P || matrix_p > MATRIX_MAX_P)) {
+        return {false, "matrix_p must be 0 (plain LSB) or between 2 and 8.", ""};
+    }
+    if (secret_file_paths.empty() || secret_file_paths.size() > MAX_ARCHIVE_ENTRIES) {
+        return {false, "An archive needs between 1 and 4096 secret files.", ""};
+    }
+
+    std::vector<const char *> secret_fnames;
+    for (const auto &path : secret_file_paths) secret_fnames.push_back(path.c_str());
+    EncodeInfo encInfo;
+    memset(&encInfo, 0, sizeof(EncodeInfo));
+    encInfo.matrix_p = static_cast<uint8_t>(matrix_p);
+    encInfo.src_image_fname = const_cast<char *>(src_image_path.c_str());
+    encInfo.stego_image_fname = const_cast<char *>(stego_image_path.c_str());
+
+    Status status;
+    {
+        py::gil_scoped_release release;
+        status = do_archive_encoding(&encInfo, secret_fnames.data(), (int)secret_fnames.size(), magic_string.c_str());
+    }
+
+    if (status == e_success) {
+        return {true, "Archive encoding successful.", stego_image_path};
+    } else {
+        remove(stego_image_path.c_str());
+        return {false, "Archive encoding failed. Check the carrier capacity and the secret files.", ""};
+    }
+}
+
+// Entries of an archive as (name, size) pairs, read from its directory only
+std::vector<std::pair<std::string, uint>> py_list_archive(const std::string &stego_image_path,
+                                                          const std::string &magic_string,
+                                                          int matrix_p)
+{
+    if (matrix_p != 0 && (matrix_p < MATRIX_MIN_P || matrix_p > MATRIX_MAX_P)) {
+        throw py::value_error("matrix_p must be 0 (plain LSB) or between 2 and 8.");
+    }
+    EncodeInfo encInfo;
+    memset(&encInfo, 0, sizeof(EncodeInfo));
+    encInfo.matrix_p = static_cast<uint8_t>(matrix_p);
+    encInfo.stego_image_fname = const_cast<char *>(stego_image_path.c_str());
+    ArchiveDirectory directory;
+    Status status = open_archive(&encInfo, magic_string.c_str(), &directory);
+    if (encInfo.fptr_stego_image) fclose(encInfo.fptr_stego_image);
+    if (encInfo.ext) free(encInfo.ext);
+    if (status == e_failure) {
+        throw py::value_error("Not an archive, or the magic string or matrix_p does not match.");
+    }
+
+    std::vector<std::pair<std::string, uint>> entries;
+    for (const auto &entry : directory.entries) entries.emplace_back(entry.name, entry.size);
+    return entries;
+}
+
+StegOperationResult py_extract_archive_entry(const std::string &stego_image_path,
+                                             const std::string &magic_string,
+                                             const std::string &entry_name,
+                                             const std::string &output_path,
+                                             int matrix_p)
+{
+    if (matrix_p != 0 && (matrix_p < MATRIX_MIN_P || matrix_p > MATRIX_MAX_P)) {
+        return {false, "matrix_p must be 0 (plain LSB) or between 2 and 8.", ""};
+    }
+    EncodeInfo encInfo;
+    memset(&encInfo, 0, sizeof(EncodeInfo));
+    encInfo.matrix_p = static_cast<uint8_t>(matrix_p);
+    encInfo.stego_image_fname = const_cast<char *>(stego_image_path.c_str());
+
+    std::string message;
+    Status status;
+    {
+        py::gil_scoped_release release;
+        ArchiveDirectory directory;
+        status = open_archive(&encInfo, magic_string.c_str(), &directory);
+        int index = status == e_success ? find_archive_entry(&directory, entry_name.c_str()) : -1;
+        if (status == e_failure) {
+            message = "Not an archive, or the magic string or matrix_p does not match.";
+        } else if (index < 0) {
+            status = e_failure;
+            message = "No entry called " + entry_name + " in the archive.";
+        } else if (open_dest_file(&encInfo, output_path.c_str()) == e_failure) {
+            status = e_failure;
+            message = "Failed to open destination file: " + output_path;
+        } else {
+            status = extract_archive_entry(&encInfo, &directory, &directory.entries[index], encInfo.fptr_dest_file);
+            if (fclose(encInfo.fptr_dest_file) != 0) status = e_failure;
+            if (status == e_failure) {
+                remove(output_path.c_str());
+                message = "Failed to extract " + entry_name + " from the archive.";
+            }
+        }
+    }
+    if (encInfo.fptr_stego_image) fclose(encInfo.fptr_stego_image);
+    if (encInfo.ext) free(encInfo.ext);
+
+    if (status == e_success) {
+        return {true, "Extraction successful.", output_path};
+    }
+    return {false, message, ""};
+}
+
+StegOperationResult py_encode_video(const std::string &src_video_path,
+                                    const std::string &secret_file_path,
+                                    const std::string &stego_video_path,
+                                    const std::string &magic_string,
+                                    int matrix_p,
+                                    uint workers,
+                                    uint max_in_flight,
+                                    py::object progress,
+                                    long progress_interval,
+                                    CancelToken *cancel_token)
+{
+    if (matrix_p != 0 && (matrix_p < MATRIX_MIN_P || matrix_p > MATRIX_MAX_P)) {
+        return {false, "matrix_p must be 0 (plain LSB) or between 2 and 8.", ""};
+    }
+    PyJobControl job(progress, progress_interval, cancel_token);
+    EncodeInfo encInfo;
+    memset(&encInfo, 0, sizeof(EncodeInfo));
+    encInfo.matrix_p = static_cast<uint8_t>(matrix_p);
+    encInfo.control = &job.control;
+    encInfo.src_image_fname = const_cast<char *>(src_video_path.c_str());
+    encInfo.secret_fname = const_cast<char *>(secret_file_path.c_str());
+    encInfo.stego_image_fname = const_cast<char *>(stego_video_path.c_str());
+    VideoOptions options = {workers, max_in_flight};
+
+    Status status;
+    {
+        py::gil_scoped_release release;
+        status = do_video_encoding(&encInfo, magic_string.c_str(), &options);
+    }
+    if (status == e_success) {
+        return {true, "Video encoding successful.", stego_video_path};
+    }
+    remove(stego_video_path.c_str());
+    if (job.cancelled()) {
+        return {false, job.stop_message(), ""};
+    }
+    return {false, "Video encoding failed. Check that the video is 8-bit Y4M and large enough for the secret.", ""};
+}
+
+StegOperationResult py_decode_video(const std::string &stego_video_path,
+                                    const std::string &output_secret_base_path,
+                                    const std::string &magic_string,
+                                    int matrix_p,
+                                    uint workers,
+                                    uint max_in_flight,
+                                    py::object progress,
+                                    long progress_interval,
+                                    CancelToken *cancel_token)
+{
+    if (matrix_p != 0 && (matrix_p < MATRIX_MIN_P || matrix_p > MATRIX_MAX_P)) {
+        return {false, "matrix_p must be 0 (plain LSB) or between 2 and 8.", ""};
+    }
+    PyJobControl job(progress, progress_interval, cancel_token);
+    EncodeInfo encInfo;
+    memset(&encInfo, 0, sizeof(EncodeInfo));
+    encInfo.matrix_p = static_cast<uint8_t>(matrix_p);
+    encInfo.control = &job.control;
+    encInfo.stego_image_fname = const_cast<char *>(stego_video_path.c_str());
+    VideoOptions options = {workers, max_in_flight};
+
+    char *output_path_c_str = nullptr;
+    Status status;
+    {
+        py::gil_scoped_release release;
+        status = do_video_decoding(&encInfo, magic_string.c_str(), output_secret_base_path.c_str(),
+                                   &output_path_c_str, &options);
+    }
+    if (status == e_success) {
+        std::string return_path = output_path_c_str;
+        free(output_path_c_str);
+        return {true, "Video decoding successful.", return_path};
+    }
+    if (job.cancelled()) {
+        return {false, job.stop_message(), ""};
+    }
+    return {false, "Video decoding failed. Check the magic string and matrix_p.", ""};
+}
+
+// Iterator returned by decode_stream: a native thread extracts the secret into a
+// small bounded queue while Python consumes it, so at most max_queued chunks are held
+class DecodeStream {
+public:
+    DecodeStream(const std::string &stego_image_path, const std::string &magic_string,
+                 int chunk_size, int matrix_p, int max_queued)
+        : stego_path_(stego_image_path), chunk_size_(chunk_size), max_queued_(max_queued)
+    {
+        if (matrix_p != 0 && (matrix_p < MATRIX_MIN_P || matrix_p > MATRIX_MAX_P)) {
+            throw py::value_error("matrix_p must be 0 (plain LSB) or between 2 and 8.");
+        }
+        if (chunk_size <= 0 || max_queued <= 0) {
+            throw py::value_error("chunk_size and max_queued must be positive.");
+        }
+        memset(&control_, 0, sizeof(control_));
+        control_.cancelled = &cancelled_;
+        memset(&encInfo_, 0, sizeof(EncodeInfo));
+        encInfo_.matrix_p = static_cast<uint8_t>(matrix_p);
+        encInfo_.control = &control_;
+        encInfo_.stego_image_fname = const_cast<char *>(stego_path_.c_str());
+
+        // The metadata is read here, so a wrong magic string raises from decode_stream itself
+        std::string error;
+        {
+            py::gil_scoped_release release;
+            if (open_decode_files(&encInfo_) == e_failure) {
+                error = "Failed to open stego image for decoding.";
+            } else if (skip_carrier_header(&encInfo_) == e_failure) {
+                error = "Unsupported or corrupt carrier.";
+            } else if (extract_magic(&encInfo_, magic_string.c_str()) == e_failure) {
+                error = "Magic string mismatch or failed to extract.";
+            } else if (decode_file_extension(&encInfo_) == e_failure) {
+                error = "Failed to decode file extension, or the secret was embedded with another matrix_p.";
+            } else if ((size_ = secret_data_size(&encInfo_)) < 0) {
+                error = "Failed to decode the secret size.";
+            }
+        }
+        if (!error.empty()) {
+            if (encInfo_.fptr_stego_image) fclose(encInfo_.fptr_stego_image);
+            if (encInfo_.ext) free(encInfo_.ext);
+            throw py::value_error(error);
+        }
+        worker_ = std::thread(&DecodeStream::run, this);
+    }
+    ~DecodeStream() {
+        close();
+        if (encInfo_.ext) free(encInfo_.ext);
+    }
+    DecodeStream(const DecodeStream &) = delete;
+    DecodeStream &operator=(const DecodeStream &) = delete;
+
+    std::string ext() const { return encInfo_.ext ? encInfo_.ext : ""; }
+    int size() const { return size_; }
+
+    py::bytes next() {
+        std::string chunk;
+        bool have_chunk = false, failed = false;
+        {
+            py::gil_scoped_release release;
+            std::unique_lock<std::mutex> lock(mutex_);
+            ready_.wait(lock, [this] { return !queue_.empty() || finished_; });
+            if (!queue_.empty()) {
+                chunk.swap(queue_.front());
+                queue_.pop_front();
+                have_chunk = true;
+                space_.notify_one();
+            }
+            failed = failed_ && !cancelled_.load();
+        }
+        if (!have_chunk) {
+            if (failed) throw py::value_error("Decoding failed while streaming the secret.");
+            throw py::stop_iteration();
+        }
+        return py::bytes(chunk);
+    }
+
+    // Stops the worker at its next chunk and drops what is still queued
+    void close() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            cancelled_.store(true);
+            queue_.clear();
+        }
+        space_.notify_all();
+        if (worker_.joinable()) worker_.join();
+    }
+
+private:
+    void run() {
+        Status status = decode_secret_chunks(&encInfo_, size_, chunk_size_, &DecodeStream::push, this);
+        fclose(encInfo_.fptr_stego_image);
+        encInfo_.fptr_stego_image = nullptr;
+        std::lock_guard<std::mutex> lock(mutex_);
+        failed_ = status == e_failure;
+        finished_ = true;
+        ready_.notify_all();
+    }
+
+    // Chunk sink of the worker; blocks while the queue is full
+    static Status push(void *ctx, const char *data, int size) {
+        DecodeStream *stream = static_cast<DecodeStream *>(ctx);
+        std::unique_lock<std::mutex> lock(stream->mutex_);
+        stream->space_.wait(lock, [stream] {
+            return stream->queue_.size() < (size_t)stream->max_queued_ || stream->cancelled_.load();
+        });
+        if (stream->cancelled_.load()) return e_failure;
+        stream->queue_.emplace_back(data, size);
+        stream->ready_.notify_one();
+        return e_success;
+    }
+
+    std::string stego_path_;
+    int chunk_size_;
+    int max_queued_;
+    int size_ = 0;
+    EncodeInfo encInfo_;
+    StegControl control_;
+    std::atomic<bool> cancelled_{false};
+    std::mutex mutex_;
+    std::condition_variable ready_; // A chunk was queued or the worker finished
+    std::condition_variable space_; // A chunk was taken or the stream was closed
+    std::deque<std::string> queue_;
+    bool finished_ = false;
+    bool failed_ = false;
+    std::thread worker_;
+};
+
+std::unique_ptr<DecodeStream> py_decode_stream(const std::string &stego_image_path,
+                                               const std::string &magic_string,
+                                               int chunk_size,
+                                               int matrix_p,
+                                               int max_queued)
+{
+    return std::unique_ptr<DecodeStream>(
+        new DecodeStream(stego_image_path, magic_string, chunk_size, matrix_p, max_queued));
+}
+
+#ifndef _WIN32
+// Directory of carriers mapped once; encodes pick the smallest one that fits
+class PyCarrierPool {
+public:
+    explicit PyCarrierPool(const std::string &dir_path) {
+        if (carrier_pool_load(&pool_, dir_path.c_str()) == e_failure) {
+            carrier_pool_free(&pool_);
+            throw py::value_error("No BMP/WAV carriers could be loaded from " + dir_path);
+        }
+    }
+    ~PyCarrierPool() { carrier_pool_free(&pool_); }
+    PyCarrierPool(const PyCarrierPool &) = delete;
+    PyCarrierPool &operator=(const PyCarrierPool &) = delete;
+
+    size_t size() const { return pool_.carriers.size(); }
+
+    // (path, capacity in bits) for every carrier, smallest first
+    std::vector<std::pair<std::string, long>> carriers() const {
+        std::vector<std::pair<std::string, long>> list;
+        for (const auto &carrier : pool_.carriers) list.emplace_back(carrier.path, carrier.capacity_bits);
+        return list;
+    }
+
+    // Path of the smallest carrier with at least needed_bits of capacity, "" if none fits
+    std::string best_fit(long needed_bits) const {
+        const PooledCarrier *carrier = carrier_pool_best_fit(&pool_, needed_bits);
+        return carrier ? carrier->path : "";
+    }
+
+    StegOperationResult encode(const std::string &secret_file_path, const std::string &stego_image_path,
+                               const std::string &magic_string, int matrix_p, bool verify) {
+        if (matrix_p != 0 && (matrix_p < MATRIX_MIN_P || matrix_p > MATRIX_MAX_P)) {
+            return {false, "matrix_p must be 0 (plain LSB) or between 2 and 8.", ""};
+        }
+        EncodeInfo encInfo;
+        memset(&encInfo, 0, sizeof(EncodeInfo));
+        encInfo.matrix_p = static_cast<uint8_t>(matrix_p);
+        encInfo.secret_fname = const_cast<char *>(secret_file_path.c_str());
+        encInfo.stego_image_fname = const_cast<char *>(stego_image_path.c_str());
+        EmbedVerify verify_info;
+        memset(&verify_info, 0, sizeof(verify_info));
+        if (verify) {
+            encInfo.verify = &verify_info;
+        }
+
+        const PooledCarrier *used = nullptr;
+        Status status;
+        std::string error;
+        {
+            py::gil_scoped_release release;
+            steg_clear_thread_error();
+            status = carrier_pool_encode(&pool_, &encInfo, magic_string.c_str(), &used);
+            error = steg_last_thread_error();
+        }
+        if (encInfo.ext) free(encInfo.ext);
+
+        if (status == e_failure) {
+            if (!used) {
+                // Nothing was written yet: the secret, a carrier that fits or the stego file was missing
+                return {false, error.empty() ? "Encoding from the carrier pool failed." : error, ""};
+            }
+            remove(stego_image_path.c_str());
+            if (verify_info.mismatches > 0) {
+                StegOperationResult result = {false, "Verification failed: " + std::to_string(verify_info.mismatches) +
+                                                     " embedded bytes read back differently.", ""};
+                result.mismatches = verify_info.mismatches;
+                return result;
+            }
+            return {false, "Encoding from the pooled carrier failed.", ""};
+        }
+        StegOperationResult result = {true, verify ? "Encoding successful and verified." : "Encoding successful.",
+                                      stego_image_path};
+        result.verified = verify;
+        result.checksum = verify_info.checksum;
+        result.carrier_path = used->path;
+        return result;
+    }
+
+private:
+    CarrierPool pool_;
+};
+
+// Result of a request served by the stegd daemon, with its per-request stats
+struct DaemonResult {
+    bool success;
+    std::string message;
+    std::string output_path;
+    std::string ext;
+    std::string data; // Inline secret returned by decode_bytes
+    int carrier;
+    uint64_t secret_size;
+    uint64_t capacity_bits;
+    uint64_t queue_us;
+    uint64_t run_us;
+    uint64_t bytes_in;
+    uint64_t bytes_out;
+    uint64_t total_requests;
+    uint64_t total_failures;
+    uint32_t workers;
+    uint32_t queued;
+};
+
+// Thin client for stegd: files are handed over as descriptors (SCM_RIGHTS),
+// so the daemon never needs access to the caller's paths
+class DaemonClient {
+public:
+    explicit DaemonClient(const std::string &socket_path) : socket_path_(socket_path) {}
+
+    DaemonResult encode(const std::string &src_image_path, const std::string &secret_file_path,
+                        const std::string &stego_image_path, const std::string &magic_string, int matrix_p)
+    {
+        int fds[3] = {open(src_image_path.c_str(), O_RDONLY | O_CLOEXEC),
+                      open(secret_file_path.c_str(), O_RDONLY | O_CLOEXEC),
+                      open(stego_image_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644)};
+        DaemonResult result = call(e_daemon_encode, fds, 3, magic_string, matrix_p,
+                                   file_extension(secret_file_path), std::string());
+        finish_output(&result, stego_image_path, stego_image_path);
+        return result;
+    }
+
+    DaemonResult encode_bytes(const std::string &src_image_path, const std::string &secret,
+                              const std::string &ext, const std::string &stego_image_path,
+                              const std::string &magic_string, int matrix_p)
+    {
+        // Checked before the stego file is opened (and truncated)
+        DaemonResult rejected = {};
+        if (secret.empty() || secret.size() > DAEMON_MAX_INLINE) {
+            rejected.message = "The secret must be between 1 byte and " +
+                               std::to_string(DAEMON_MAX_INLINE / (1024 * 1024)) + " MiB.";
+            return rejected;
+        }
+        if (ext.size() >= DAEMON_EXT_SIZE) {
+            rejected.message = "File extension is too long.";
+            return rejected;
+        }
+        int fds[2] = {open(src_image_path.c_str(), O_RDONLY | O_CLOEXEC),
+                      open(stego_image_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644)};
+        DaemonResult result = call(e_daemon_encode, fds, 2, magic_string, matrix_p, ext, secret);
+        finish_output(&result, stego_image_path, stego_image_path);
+        return result;
+    }
+
+    DaemonResult decode(const std::string &stego_image_path, const std::string &output_secret_base_path,
+                        const std::string &magic_string, int matrix_p)
+    {
+        // The extension is only known once the daemon has read it, so decode
+        // into a temporary name and rename afterwards
+        std::string partial_path = output_secret_base_path + ".part";
+        int fds[2] = {open(stego_image_path.c_str(), O_RDONLY | O_CLOEXEC),
+                      open(partial_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644)};
+        DaemonResult result = call(e_daemon_decode, fds, 2, magic_string, matrix_p, "", std::string());
+        finish_output(&result, partial_path, output_secret_base_path + result.ext);
+        return result;
+    }
+
+    DaemonResult decode_bytes(const std::string &stego_image_path, const std::string &magic_string, int matrix_p)
+    {
+        int fds[1] = {open(stego_image_path.c_str(), O_RDONLY | O_CLOEXEC)};
+        return call(e_daemon_decode, fds, 1, magic_string, matrix_p, "", std::string());
+    }
+
+    DaemonResult probe(const std::string &stego_image_path, const std::string &magic_string, int matrix_p)
+    {
+        int fds[1] = {open(stego_image_path.c_str(), O_RDONLY | O_CLOEXEC)};
+        return call(e_daemon_probe, fds, 1, magic_string, matrix_p, "", std::string());
+    }
+
+    DaemonResult stats()
+    {
+        return call(e_daemon_stats, NULL, 0, "", 0, "", std::string());
+    }
+
+private:
+    static std::string file_extension(const std::string &path)
+    {
+        size_t name_start = path.find_last_of("/\\");
+        name_start = name_start == std::string::npos ? 0 : name_start + 1;
+        size_t dot = path.rfind('.');
+        if (dot == std::string::npos || dot <= name_start) {
+            return "";
+        }
+        return path.substr(dot);
+    }
+
+    // Moves a finished output into place, or removes it if the request failed
+    static void finish_output(DaemonResult *result, const std::string &written_path, const std::string &final_path)
+    {
+        if (!result->success) {
+            remove(written_path.c_str());
+            return;
+        }
+        if (written_path != final_path && rename(written_path.c_str(), final_path.c_str()) != 0) {
+            result->success = false;
+            result->message = "Failed to move the output to " + final_path;
+            remove(written_path.c_str());
+            return;
+        }
+        result->output_path = final_path;
+    }
+
+    // Sends one request and closes the caller's copies of the descriptors
+    DaemonResult call(DaemonOp op, int *fds, int fd_count, const std::string &magic_string, int matrix_p,
+                      const std::string &ext, const std::string &inline_secret)
+    {
+        DaemonResult result = {};
+        for (int i = 0; i < fd_count; ++i) {
+            if (fds[i] < 0) {
+                for (int j = 0; j < fd_count; ++j) if (fds[j] >= 0) close(fds[j]);
+                result.message = "Failed to open input/output files.";
+                return result;
+            }
+        }
+        if (ext.size() >= DAEMON_EXT_SIZE) {
+            for (int i = 0; i < fd_count; ++i) close(fds[i]);
+            result.message = "File extension is too long.";
+            return result;
+        }
+        if (op != e_daemon_stats &&
+            (magic_string.empty() || magic_string.size() >= sizeof(((EncodeInfo *)0)->MAGIC_STRING))) {
+            for (int i = 0; i < fd_count; ++i) close(fds[i]);
+            result.message = "The magic string must be 1 to " +
+                             std::to_string(sizeof(((EncodeInfo *)0)->MAGIC_STRING) - 1) + " characters.";
+            return result;
+        }
+
+        DaemonRequest request;
+        memset(&request, 0, sizeof(request));
+        request.protocol_magic = DAEMON_PROTOCOL_MAGIC;
+        request.op = op;
+        request.matrix_p = (uint32_t)matrix_p;
+        request.fd_count = (uint32_t)fd_count;
+        request.magic_len = (uint32_t)magic_string.size();
+        request.inline_len = (uint32_t)inline_secret.size();
+        strncpy(request.ext, ext.c_str(), sizeof(request.ext) - 1);
+
+        DaemonResponse response;
+        std::vector<char> inline_data(inline_secret.begin(), inline_secret.end());
+        std::vector<char> payload;
+        Status status;
+        {
+            py::gil_scoped_release release;
+            status = daemon_call(socket_path_.c_str(), &request, fds, magic_string, inline_data, &response, &payload);
+        }
+        for (int i = 0; i < fd_count; ++i) close(fds[i]);
+
+        if (status == e_failure) {
+            result.message = "Failed to talk to stegd at " + socket_path_;
+            return result;
+        }
+        response.ext[sizeof(response.ext) - 1] = '\0';
+        response.message[sizeof(response.message) - 1] = '\0';
+        result.success = response.status == e_success;
+        result.message = response.message;
+        result.ext = response.ext;
+        result.data.assign(payload.begin(), payload.end());
+        result.carrier = (int)response.carrier;
+        result.secret_size = response.secret_size;
+        result.capacity_bits = response.capacity_bits;
+        result.queue_us = response.queue_us;
+        result.run_us = response.run_us;
+        result.bytes_in = response.bytes_in;
+        result.bytes_out = response.bytes_out;
+        result.total_requests = response.total_requests;
+        result.total_failures = response.total_failures;
+        result.workers = response.workers;
+        result.queued = response.queued;
+        return result;
+    }
+
+    std::string socket_path_;
+};
+#endif
+
 
 PYBIND11_MODULE(steganography_engine, m) {
     m.doc() = "Python bindings for C++ LSB Steganography";
@@ -213,16 +989,155 @@ PYBIND11_MODULE(steganography_engine, m) {
     py::class_<StegOperationResult>(m, "StegOperationResult")
         .def_readonly("success", &StegOperationResult::success)
         .def_readonly("message", &StegOperationResult::message)
-        .def_readonly("output_path", &StegOperationResult::output_path);
+        .def_readonly("output_path", &StegOperationResult::output_path)
+        .def_readonly("output_paths", &StegOperationResult::output_paths)
+        .def_readonly("verified", &StegOperationResult::verified)
+        .def_readonly("mismatches", &StegOperationResult::mismatches)
+        .def_readonly("checksum", &StegOperationResult::checksum)
+        .def_readonly("carrier_path", &StegOperationResult::carrier_path);
+
+    py::class_<CancelToken>(m, "CancelToken")
+        .def(py::init<>())
+        .def("cancel", &CancelToken::cancel, "Stops the encode/decode using this token at its next block")
+        .def_property_readonly("cancelled", &CancelToken::cancelled);
 
     m.def("encode", &py_encode, "Encodes a secret file into a source image",
           py::arg("src_image_path"),
           py::arg("secret_file_path"),
           py::arg("stego_image_path"),
-          py::arg("magic_string"));
+          py::arg("magic_string"),
+          py::arg("matrix_p") = 0,
+          py::arg("progress") = py::none(),
+          py::arg("progress_interval") = STEG_PROGRESS_INTERVAL,
+          py::arg("cancel_token") = nullptr,
+          py::arg("verify") = false);
 
     m.def("decode", &py_decode, "Decodes a secret file from a stego image",
           py::arg("stego_image_path"),
           py::arg("output_secret_base_path"),
+          py::arg("magic_string"),
+          py::arg("matrix_p") = 0,
+          py::arg("progress") = py::none(),
+          py::arg("progress_interval") = STEG_PROGRESS_INTERVAL,
+          py::arg("cancel_token") = nullptr);
+
+    m.def("encode_striped", &py_encode_striped, "Splits a secret file across several source images",
+          py::arg("src_image_paths"),
+          py::arg("secret_file_path"),
+          py::arg("stego_image_paths"),
+          py::arg("magic_string"));
+
+    m.def("decode_striped", &py_decode_striped, "Reassembles a secret file from its stego images, in any order",
+          py::arg("stego_image_paths"),
+          py::arg("output_secret_base_path"),
           py::arg("magic_string"));
+
+    m.def("encode_archive", &py_encode_archive, "Writes several secret files into one carrier as an archive",
+          py::arg("src_image_path"),
+          py::arg("secret_file_paths"),
+          py::arg("stego_image_path"),
+          py::arg("magic_string"),
+          py::arg("matrix_p") = 0);
+
+    m.def("list_archive", &py_list_archive, "Lists the (name, size) entries of an archive from its directory",
+          py::arg("stego_image_path"),
+          py::arg("magic_string"),
+          py::arg("matrix_p") = 0);
+
+    m.def("extract_archive_entry", &py_extract_archive_entry, "Extracts one archive entry by seeking to its samples",
+          py::arg("stego_image_path"),
+          py::arg("magic_string"),
+          py::arg("entry_name"),
+          py::arg("output_path"),
+          py::arg("matrix_p") = 0);
+
+    m.def("encode_video", &py_encode_video,
+          "Spreads a secret file over the frames of a Y4M video, embedding frames in parallel",
+          py::arg("src_video_path"),
+          py::arg("secret_file_path"),
+          py::arg("stego_video_path"),
+          py::arg("magic_string"),
+          py::arg("matrix_p") = 0,
+          py::arg("workers") = 0,
+          py::arg("max_in_flight") = 0,
+          py::arg("progress") = py::none(),
+          py::arg("progress_interval") = STEG_PROGRESS_INTERVAL,
+          py::arg("cancel_token") = nullptr);
+
+    m.def("decode_video", &py_decode_video, "Reassembles a secret file from the frames of a Y4M video",
+          py::arg("stego_video_path"),
+          py::arg("output_secret_base_path"),
+          py::arg("magic_string"),
+          py::arg("matrix_p") = 0,
+          py::arg("workers") = 0,
+          py::arg("max_in_flight") = 0,
+          py::arg("progress") = py::none(),
+          py::arg("progress_interval") = STEG_PROGRESS_INTERVAL,
+          py::arg("cancel_token") = nullptr);
+
+    py::class_<DecodeStream>(m, "DecodeStream")
+        .def("__iter__", [](DecodeStream &stream) -> DecodeStream & { return stream; },
+             py::return_value_policy::reference_internal)
+        .def("__next__", &DecodeStream::next)
+        .def("close", &DecodeStream::close, "Stops the background extraction and ends the iteration")
+        .def_property_readonly("ext", &DecodeStream::ext)
+        .def_property_readonly("size", &DecodeStream::size);
+
+    m.def("decode_stream", &py_decode_stream,
+          "Decodes a secret as an iterator of bytes chunks, extracted by a background thread",
+          py::arg("stego_image_path"),
+          py::arg("magic_string"),
+          py::arg("chunk_size") = STEG_BLOCK_SIZE,
+          py::arg("matrix_p") = 0,
+          py::arg("max_queued") = 4);
+
+#ifndef _WIN32
+    py::class_<PyCarrierPool>(m, "CarrierPool")
+        .def(py::init<const std::string &>(), py::arg("dir_path"))
+        .def("__len__", &PyCarrierPool::size)
+        .def_property_readonly("carriers", &PyCarrierPool::carriers)
+        .def("best_fit", &PyCarrierPool::best_fit, "Smallest carrier with at least needed_bits of capacity",
+             py::arg("needed_bits"))
+        .def("encode", &PyCarrierPool::encode, "Encodes a secret into the smallest pooled carrier that fits",
+             py::arg("secret_file_path"),
+             py::arg("stego_image_path"),
+             py::arg("magic_string"),
+             py::arg("matrix_p") = 0,
+             py::arg("verify") = false);
+
+    py::class_<DaemonResult>(m, "DaemonResult")
+        .def_readonly("success", &DaemonResult::success)
+        .def_readonly("message", &DaemonResult::message)
+        .def_readonly("output_path", &DaemonResult::output_path)
+        .def_readonly("ext", &DaemonResult::ext)
+        .def_property_readonly("data", [](const DaemonResult &r) { return py::bytes(r.data); })
+        .def_readonly("carrier", &DaemonResult::carrier)
+        .def_readonly("secret_size", &DaemonResult::secret_size)
+        .def_readonly("capacity_bits", &DaemonResult::capacity_bits)
+        .def_readonly("queue_us", &DaemonResult::queue_us)
+        .def_readonly("run_us", &DaemonResult::run_us)
+        .def_readonly("bytes_in", &DaemonResult::bytes_in)
+        .def_readonly("bytes_out", &DaemonResult::bytes_out)
+        .def_readonly("total_requests", &DaemonResult::total_requests)
+        .def_readonly("total_failures", &DaemonResult::total_failures)
+        .def_readonly("workers", &DaemonResult::workers)
+        .def_readonly("queued", &DaemonResult::queued);
+
+    py::class_<DaemonClient>(m, "DaemonClient")
+        .def(py::init<const std::string &>(), py::arg("socket_path") = std::string(DAEMON_DEFAULT_SOCKET))
+        .def("encode", &DaemonClient::encode, "Encodes a secret file through the stegd daemon",
+             py::arg("src_image_path"), py::arg("secret_file_path"), py::arg("stego_image_path"),
+             py::arg("magic_string"), py::arg("matrix_p") = 0)
+        .def("encode_bytes", &DaemonClient::encode_bytes, "Encodes an in-memory secret through the stegd daemon",
+             py::arg("src_image_path"), py::arg("secret"), py::arg("ext"), py::arg("stego_image_path"),
+             py::arg("magic_string"), py::arg("matrix_p") = 0)
+        .def("decode", &DaemonClient::decode, "Decodes a secret file through the stegd daemon",
+             py::arg("stego_image_path"), py::arg("output_secret_base_path"),
+             py::arg("magic_string"), py::arg("matrix_p") = 0)
+        .def("decode_bytes", &DaemonClient::decode_bytes, "Decodes a secret into memory through the stegd daemon",
+             py::arg("stego_image_path"), py::arg("magic_string"), py::arg("matrix_p") = 0)
+        .def("probe", &DaemonClient::probe, "Checks the magic string and reads the secret's extension and size",
+             py::arg("stego_image_path"), py::arg("magic_string"), py::arg("matrix_p") = 0)
+        .def("stats", &DaemonClient::stats, "Returns the daemon-wide request counters");
+#endif
 }
\ No newline at end of file
@@ -0,0 +1,326 @@
+// stegctl.cpp
+// Batch front end of libsteg: runs the jobs of a JSONL manifest in parallel
+// and prints one JSON result line per job as it finishes.
+//
+// Usage: stegctl [-j jobs] [-v] [manifest.jsonl | -]
+//
+// Manifest lines (blank lines and lines starting with '#' are skipped):
+//   {"op":"encode","src":"cover.bmp","secret":"a.txt","stego":"out.bmp","magic":"key","matrix_p":3,"verify":true}
+//   {"op":"decode","stego":"out.bmp","output":"decoded/a","magic":"key","matrix_p":3}
+//
+// Exit status: 0 if every job succeeded, 1 if any job failed, 2 on a usage or manifest error.
+#include "steg_api.h"
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+typedef std::map<std::string, std::string> JsonObject;
+
+struct Job {
+    int line;
+    JsonObject fields;
+};
+
+std::mutex output_mutex;
+
+/* Parses one flat JSON object; values are kept as text
+ * Strings are unescaped, numbers and true/false/null are copied as written.
+ * Nested objects and arrays are rejected, no manifest field needs them.
+ */
+class JsonLineParser {
+public:
+    explicit JsonLineParser(const std::string &text) : text_(text), pos_(0) {}
+
+    bool parse(JsonObject *object, std::string *error) {
+        skip_space();
+        if (!consume('{')) return fail(error, "expected '{'");
+        skip_space();
+        if (consume('}')) return at_end(error);
+        for (;;) {
+            std::string key, value;
+            skip_space();
+            if (!parse_string(&key)) return fail(error, "expected a string key");
+            skip_space();
+            if (!consume(':')) return fail(error, "expected ':'");
+            skip_space();
+            if (peek() == '"') {
+                if (!parse_string(&value)) return fail(error, "bad string value");
+            } else if (!parse_scalar(&value)) {
+                return fail(error, "expected a string, number, true, false or null");
+            }
+            (*object)[key] = value;
+            skip_space();
+            if (consume('}')) return at_end(error);
+            if (!consume(',')) return fail(error, "expected ',' or '}'");
+        }
+    }
+
+private:
+    char peek() const { return pos_ < text_.size() ? text_[pos_] : '\0'; }
+
+    bool consume(char c) {
+        if (peek() != c) return false;
+        ++pos_;
+        return true;
+    }
+
+    void skip_space() {
+        while (pos_ < text_.size() && strchr(" \t\r\n", text_[pos_])) ++pos_;
+    }
+
+    bool fail(std::string *error, const char *what) {
+        *error = std::string(what) + " at column " + std::to_string(pos_ + 1);
+        return false;
+    }
+
+    bool at_end(std::string *error) {
+        skip_space();
+        return pos_ == text_.size() ? true : fail(error, "trailing characters");
+    }
+
+    void append_utf8(std::string *out, unsigned code) {
+        if (code < 0x80) {
+            out->push_back((char)code);
+        } else if (code < 0x800) {
+            out->push_back((char)(0xC0 | (code >> 6)));
+            out->push_back((char)(0x80 | (code & 0x3F)));
+        } else {
+            out->push_back((char)(0xE0 | (code >> 12)));
+            out->push_back((char)(0x80 | ((code >> 6) & 0x3F)));
+            out->push_back((char)(0x80 | (code & 0x3F)));
+        }
+    }
+
+    bool parse_string(std::string *out) {
+        if (!consume('"')) return false;
+        while (pos_ < text_.size()) {
+            char c = text_[pos_++];
+            if (c == '"') return true;
+            if (c != '\\') {
+                out->push_back(c);
+                continue;
+            }
+            if (pos_ >= text_.size()) return false;
+            char escape = text_[pos_++];
+            switch (escape) {
+            case '"': case '\\': case '/': out->push_back(escape); break;
+            case 'b': out->push_back('\b'); break;
+            case 'f': out->push_back('\f'); break;
+            case 'n': out->push_back('\n'); break;
+            case 'r': out->push_back('\r'); break;
+            case 't': out->push_back('\t'); break;
+            case 'u': {
+                if (pos_ + 4 > text_.size()) return false;
+                char *end = NULL;
+                std::string hex = text_.substr(pos_, 4);
+                unsigned code = (unsigned)strtoul(hex.c_str(), &end, 16);
+                if (*end != '\0') return false;
+                append_utf8(out, code);
+                pos_ += 4;
+                break;
+            }
+            default: return false;
+            }
+        }
+        return false;
+    }
+
+    bool parse_scalar(std::string *out) {
+        size_t start = pos_;
+        while (pos_ < text_.size() && (isalnum((unsigned char)text_[pos_]) || strchr("+-.", text_[pos_]))) ++pos_;
+        *out = text_.substr(start, pos_ - start);
+        if (*out == "true" || *out == "false" || *out == "null") return true;
+        char *end = NULL;
+        strtod(out->c_str(), &end);
+        return !out->empty() && *end == '\0';
+    }
+
+    const std::string &text_;
+    size_t pos_;
+};
+
+std::string json_escape(const std::string &text) {
+    std::string out = "\"";
+    for (size_t i = 0; i < text.size(); ++i) {
+        unsigned char c = (unsigned char)text[i];
+        if (c == '"' || c == '\\') {
+            out.push_back('\\');
+            out.push_back((char)c);
+        } else if (c < 0x20) {
+            char buffer[8];
+            snprintf(buffer, sizeof(buffer), "\\u%04x", c);
+            out += buffer;
+        } else {
+            out.push_back((char)c);
+        }
+    }
+    return out + "\"";
+}
+
+const std::string &field(const Job &job, const char *name) {
+    static const std::string empty;
+    JsonObject::const_iterator it = job.fields.find(name);
+    return it == job.fields.end() ? empty : it->second;
+}
+
+// Runs one manifest job on the worker's context and prints its result line
+bool run_job(steg_context *ctx, size_t index, const Job &job) {
+    Clock::time_point start = Clock::now();
+    const std::string &op = field(job, "op");
+    std::string output, error;
+    steg_status status = steg_set_matrix_p(ctx, atoi(field(job, "matrix_p").c_str()));
+    if (status != STEG_OK) {
+        error = "matrix_p must be 0 (plain LSB) or between 2 and 8";
+    } else {
+        steg_set_verify(ctx, field(job, "verify") == "true");
+        if (op == "encode") {
+            status = steg_encode(ctx, field(job, "src").c_str(), field(job, "secret").c_str(),
+                                 field(job, "stego").c_str(), field(job, "magic").c_str());
+            output = field(job, "stego");
+        } else if (op == "decode") {
+            status = steg_decode(ctx, field(job, "stego").c_str(), field(job, "output").c_str(),
+                                 field(job, "magic").c_str(), NULL, 0);
+            output = steg_last_output_path(ctx);
+        } else {
+            status = STEG_ERR_INVALID_ARGUMENT;
+            error = "unknown op, expected encode or decode";
+        }
+        if (status != STEG_OK && error.empty()) {
+            error = steg_last_error(ctx);
+        }
+    }
+    double ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+    std::string line = "{\"job\":" + std::to_string(index) + ",\"line\":" + std::to_string(job.line) +
+                       ",\"op\":" + json_escape(op) + ",\"status\":" + json_escape(steg_status_string(status)) +
+                       ",\"code\":" + std::to_string((int)status);
+    if (status == STEG_OK) {
+        line += ",\"output\":" + json_escape(output);
+        if (op == "encode" && field(job, "verify") == "true") {
+            char checksum[16];
+            snprintf(checksum, sizeof(checksum), "%08x", (unsigned)steg_last_checksum(ctx));
+            line += ",\"checksum\":\"" + std::string(checksum) + "\"";
+        }
+    } else {
+        line += ",\"error\":" + json_escape(error);
+    }
+    char timing[32];
+    snprintf(timing, sizeof(timing), ",\"ms\":%.3f}\n", ms);
+    line += timing;
+
+    std::lock_guard<std::mutex> lock(output_mutex);
+    fputs(line.c_str(), stdout);
+    fflush(stdout);
+    return status == STEG_OK;
+}
+
+void log_to_stderr(void *, int, const char *message) {
+    std::lock_guard<std::mutex> lock(output_mutex);
+    fputs(message, stderr);
+}
+
+int usage() {
+    fprintf(stderr, "Usage: stegctl [-j jobs] [-v] [manifest.jsonl | -]\n");
+    return 2;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    unsigned concurrency = std::thread::hardware_concurrency();
+    bool verbose = false;
+    const char *manifest_path = "-";
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "-j") == 0 && i + 1 < argc) {
+            concurrency = (unsigned)atoi(argv[++i]);
+        } else if (strncmp(argv[i], "-j", 2) == 0 && argv[i][2] != '\0') {
+            concurrency = (unsigned)atoi(argv[i] + 2);
+        } else if (strcmp(argv[i], "-v") == 0) {
+            verbose = true;
+        } else if (argv[i][0] == '-' && argv[i][1] != '\0') {
+            return usage();
+        } else {
+            manifest_path = argv[i];
+        }
+    }
+    if (concurrency == 0) {
+        concurrency = 1;
+    }
+
+    FILE *manifest = strcmp(manifest_path, "-") == 0 ? stdin : fopen(manifest_path, "r");
+    if (!manifest) {
+        fprintf(stderr, "ERROR: Unable to open manifest %s\n", manifest_path);
+        return 2;
+    }
+    std::vector<Job> jobs;
+    std::string text;
+    int line_number = 0;
+    char chunk[4096];
+    bool line_done = true;
+    while (fgets(chunk, sizeof(chunk), manifest)) {
+        if (line_done) {
+            text.clear();
+            ++line_number;
+        }
+        text += chunk;
+        line_done = !text.empty() && text.back() == '\n';
+        if (!line_done && !feof(manifest)) continue;
+
+        size_t first = text.find_first_not_of(" \t\r\n");
+        if (first == std::string::npos || text[first] == '#') continue;
+        Job job;
+        job.line = line_number;
+        std::string error;
+        if (!JsonLineParser(text).parse(&job.fields, &error)) {
+            fprintf(stderr, "ERROR: %s:%d: %s\n", manifest_path, line_number, error.c_str());
+            return 2;
+        }
+        jobs.push_back(job);
+    }
+    if (manifest != stdin) fclose(manifest);
+
+    if (verbose) {
+        steg_set_log_callback(log_to_stderr, NULL);
+    }
+    if (concurrency > jobs.size()) {
+        concurrency = jobs.empty() ? 1 : (unsigned)jobs.size();
+    }
+
+    Clock::time_point start = Clock::now();
+    std::atomic<size_t> next_job(0);
+    std::atomic<size_t> failures(0);
+    std::vector<std::thread> workers;
+    for (unsigned i = 0; i < concurrency; ++i) {
+        workers.emplace_back([&] {
+            steg_context *ctx = NULL;
+            if (steg_context_new(&ctx) != STEG_OK) {
+                failures += 1;
+                return;
+            }
+            for (size_t index; (index = next_job.fetch_add(1)) < jobs.size();) {
+                if (!run_job(ctx, index, jobs[index])) {
+                    failures += 1;
+                }
+            }
+            steg_context_free(ctx);
+        });
+    }
+    for (auto &worker : workers) {
+        worker.join();
+    }
+    double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    fprintf(stderr, "stegctl: %zu jobs, %zu failed, %u workers, %.3f s\n",
+            jobs.size(), failures.load(), concurrency, seconds);
+    return failures.load() == 0 ? 0 : 1;
+}
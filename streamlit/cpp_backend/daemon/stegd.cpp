@@ -0,0 +1,434 @@
+// stegd.cpp
+// Local steganography daemon: serves encode/decode/probe requests over a
+// Unix domain socket on a shared worker pool (see daemon.h for the protocol).
+//
+// Usage: stegd [socket_path] [workers]
+#include "daemon.h"
+#include "common.h"
+#include "encode.h"
+#include "decode.h"
+#include "carrier.h"
+#include "matrix.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <cerrno>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+struct PendingRequest {
+    int sock;
+    Clock::time_point accepted;
+};
+
+// Connections waiting for a worker
+class RequestQueue {
+public:
+    void push(const PendingRequest &request) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        requests_.push_back(request);
+        cond_.notify_one();
+    }
+
+    // Returns false once the queue is shut down and drained
+    bool pop(PendingRequest *request) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        cond_.wait(lock, [this] { return !requests_.empty() || shutdown_; });
+        if (requests_.empty()) {
+            return false;
+        }
+        *request = requests_.front();
+        requests_.pop_front();
+        return true;
+    }
+
+    void shutdown() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        shutdown_ = true;
+        cond_.notify_all();
+    }
+
+    uint32_t size() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return (uint32_t)requests_.size();
+    }
+
+private:
+    std::mutex mutex_;
+    std::condition_variable cond_;
+    std::deque<PendingRequest> requests_;
+    bool shutdown_ = false;
+};
+
+#define MAX_WORKERS 1024
+
+RequestQueue queue;
+std::atomic<uint64_t> total_requests(0);
+std::atomic<uint64_t> total_failures(0);
+uint32_t worker_count = 0;
+volatile sig_atomic_t stop_requested = 0;
+
+void on_stop_signal(int) {
+    stop_requested = 1;
+}
+
+uint64_t elapsed_us(Clock::time_point since) {
+    return (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - since).count();
+}
+
+void set_message(DaemonResponse *response, const char *message) {
+    strncpy(response->message, message, sizeof(response->message) - 1);
+}
+
+// Wraps a received descriptor in a FILE; the FILE owns it from here on
+FILE *adopt_fd(int *fd, const char *mode) {
+    FILE *fptr = fdopen(*fd, mode);
+    if (fptr) {
+        *fd = -1;
+    }
+    return fptr;
+}
+
+long stream_size(FILE *fptr) {
+    long pos = ftell(fptr);
+    fseek(fptr, 0, SEEK_END);
+    long size = ftell(fptr);
+    fseek(fptr, pos, SEEK_SET);
+    return size;
+}
+
+void handle_encode(const DaemonRequest *request, int *fds, int fd_count, const std::string &magic,
+                   std::vector<char> &inline_data, DaemonResponse *response) {
+    bool inline_secret = request->inline_len > 0;
+    if (fd_count != (inline_secret ? 2 : 3)) {
+        set_message(response, "Encode needs src and stego descriptors, plus a secret descriptor or inline data.");
+        return;
+    }
+
+    EncodeInfo encInfo;
+    memset(&encInfo, 0, sizeof(EncodeInfo));
+    encInfo.matrix_p = (uint8_t)request->matrix_p;
+    // do_encoding takes the extension from the secret's file name
+    std::string secret_name = std::string("secret") + request->ext;
+    encInfo.secret_fname = &secret_name[0];
+
+    encInfo.fptr_src_image = adopt_fd(&fds[0], "rb");
+    if (inline_secret) {
+        encInfo.fptr_secret = fmemopen(inline_data.data(), inline_data.size(), "rb");
+        encInfo.fptr_stego_image = adopt_fd(&fds[1], "wb");
+    } else {
+        encInfo.fptr_secret = adopt_fd(&fds[1], "rb");
+        encInfo.fptr_stego_image = adopt_fd(&fds[2], "wb");
+    }
+    if (!encInfo.fptr_src_image || !encInfo.fptr_secret || !encInfo.fptr_stego_image) {
+        close_encode_files(&encInfo);
+        set_message(response, "Failed to open the passed descriptors.");
+        return;
+    }
+
+    long carrier_size = stream_size(encInfo.fptr_src_image);
+    response->secret_size = get_file_size(encInfo.fptr_secret);
+    response->bytes_in = carrier_size + response->secret_size;
+    if (do_encoding(&encInfo, magic.c_str()) == e_success) {
+        response->status = e_success;
+        response->bytes_out = carrier_size;
+        set_message(response, "Encoding successful.");
+    } else {
+        set_message(response, "Encoding failed. Check carrier capacity and file integrity.");
+    }
+    response->carrier = encInfo.carrier.type;
+    response->capacity_bits = get_carrier_capacity_bits(&encInfo.carrier);
+    close_encode_files(&encInfo);
+    free(encInfo.ext);
+}
+
+/* Shared by decode and probe: validates the magic string and reads the
+ * extension, leaving the stego stream at the secret size field
+ */
+Status read_stego_header(EncodeInfo *encInfo, const std::string &magic, DaemonResponse *response) {
+    if (skip_carrier_header(encInfo) == e_failure) {
+        set_message(response, "Unsupported stego carrier.");
+        return e_failure;
+    }
+    response->carrier = encInfo->carrier.type;
+    response->capacity_bits = get_carrier_capacity_bits(&encInfo->carrier);
+    if (extract_magic(encInfo, magic.c_str()) == e_failure) {
+        set_message(response, "Magic string validation failed.");
+        return e_failure;
+    }
+    if (decode_file_extension(encInfo) == e_failure) {
+        set_message(response, "Failed to decode file extension, or the secret was embedded with another matrix_p.");
+        return e_failure;
+    }
+    strncpy(response->ext, encInfo->ext, sizeof(response->ext) - 1);
+    return e_success;
+}
+
+void handle_decode(const DaemonRequest *request, int *fds, int fd_count, const std::string &magic,
+                   DaemonResponse *response, std::vector<char> *payload) {
+    if (fd_count != 1 && fd_count != 2) {
+        set_message(response, "Decode needs a stego descriptor and optionally a destination descriptor.");
+        return;
+    }
+
+    EncodeInfo encInfo;
+    memset(&encInfo, 0, sizeof(EncodeInfo));
+    encInfo.matrix_p = (uint8_t)request->matrix_p;
+    encInfo.fptr_stego_image = adopt_fd(&fds[0], "rb");
+    if (!encInfo.fptr_stego_image) {
+        set_message(response, "Failed to open the stego descriptor.");
+        return;
+    }
+    response->bytes_in = stream_size(encInfo.fptr_stego_image);
+
+    char *memory = NULL;
+    size_t memory_size = 0;
+    if (read_stego_header(&encInfo, magic, response) == e_success) {
+        encInfo.fptr_dest_file = fd_count == 2 ? adopt_fd(&fds[1], "wb") : open_memstream(&memory, &memory_size);
+        if (!encInfo.fptr_dest_file) {
+            set_message(response, "Failed to open the destination.");
+        } else if (decode_secret_data(&encInfo) == e_failure) {
+            set_message(response, "Decoding failed.");
+        } else {
+            response->status = e_success;
+            set_message(response, "Decoding successful.");
+        }
+        if (encInfo.fptr_dest_file) {
+            response->secret_size = ftell(encInfo.fptr_dest_file);
+            if (fclose(encInfo.fptr_dest_file) != 0) {
+                response->status = e_failure;
+            }
+        }
+    }
+    response->bytes_out = response->secret_size;
+
+    if (memory) {
+        if (response->status == e_success) {
+            payload->assign(memory, memory + memory_size);
+            response->payload_len = (uint32_t)memory_size;
+        }
+        free(memory);
+    }
+    free(encInfo.ext);
+    fclose(encInfo.fptr_stego_image);
+}
+
+void handle_probe(const DaemonRequest *request, int *fds, int fd_count, const std::string &magic,
+                  DaemonResponse *response) {
+    if (fd_count != 1) {
+        set_message(response, "Probe needs exactly one stego descriptor.");
+        return;
+    }
+
+    EncodeInfo encInfo;
+    memset(&encInfo, 0, sizeof(EncodeInfo));
+    encInfo.matrix_p = (uint8_t)request->matrix_p;
+    encInfo.fptr_stego_image = adopt_fd(&fds[0], "rb");
+    if (!encInfo.fptr_stego_image) {
+        set_message(response, "Failed to open the stego descriptor.");
+        return;
+    }
+    if (read_stego_header(&encInfo, magic, response) == e_success) {
+        int size = secret_data_size(&encInfo);
+        if (size < 0) {
+            set_message(response, "Failed to decode the secret size.");
+        } else {
+            response->secret_size = (uint64_t)size;
+            response->status = e_success;
+            set_message(response, "Magic string matches.");
+        }
+    }
+    free(encInfo.ext);
+    fclose(encInfo.fptr_stego_image);
+}
+
+void serve_request(const PendingRequest &pending) {
+    DaemonResponse response;
+    memset(&response, 0, sizeof(response));
+    response.protocol_magic = DAEMON_PROTOCOL_MAGIC;
+    response.status = e_failure;
+    response.queue_us = elapsed_us(pending.accepted);
+
+    DaemonRequest request;
+    int fds[DAEMON_MAX_FDS];
+    int fd_count = 0;
+    std::string magic;
+    std::vector<char> inline_data, payload;
+
+    // Idle or slow clients are dropped once the request budget runs out
+    long budget_ms = DAEMON_REQUEST_TIMEOUT_MS;
+    Clock::time_point started = Clock::now();
+    if (daemon_recv_within(pending.sock, &request, sizeof(request), fds, &fd_count, &budget_ms) == e_failure) {
+        for (int i = 0; i < fd_count; ++i) close(fds[i]);
+        close(pending.sock);
+        return;
+    }
+    request.ext[sizeof(request.ext) - 1] = '\0';
+
+    bool valid = request.protocol_magic == DAEMON_PROTOCOL_MAGIC &&
+                 (request.magic_len > 0 || request.op == e_daemon_stats) &&
+                 request.magic_len < sizeof(((EncodeInfo *)0)->MAGIC_STRING) &&
+                 request.inline_len <= DAEMON_MAX_INLINE &&
+                 (request.matrix_p == 0 || (request.matrix_p >= MATRIX_MIN_P && request.matrix_p <= MATRIX_MAX_P));
+    if (valid) {
+        magic.resize(request.magic_len);
+        inline_data.resize(request.inline_len);
+        valid = (request.magic_len == 0 ||
+                 daemon_recv_within(pending.sock, &magic[0], magic.size(), NULL, NULL, &budget_ms) == e_success) &&
+                (request.inline_len == 0 ||
+                 daemon_recv_within(pending.sock, inline_data.data(), inline_data.size(), NULL, NULL, &budget_ms) == e_success);
+    }
+
+    if (!valid) {
+        set_message(&response, "Malformed request.");
+    } else {
+        switch (request.op) {
+        case e_daemon_encode:
+            handle_encode(&request, fds, fd_count, magic, inline_data, &response);
+            break;
+        case e_daemon_decode:
+            handle_decode(&request, fds, fd_count, magic, &response, &payload);
+            break;
+        case e_daemon_probe:
+            handle_probe(&request, fds, fd_count, magic, &response);
+            break;
+        case e_daemon_stats:
+            response.status = e_success;
+            set_message(&response, "OK");
+            break;
+        default:
+            set_message(&response, "Unknown operation.");
+            break;
+        }
+    }
+    for (int i = 0; i < fd_count; ++i) {
+        if (fds[i] >= 0) close(fds[i]);
+    }
+    response.run_us = elapsed_us(started);
+
+    total_requests++;
+    if (response.status != e_success) total_failures++;
+    response.total_requests = total_requests;
+    response.total_failures = total_failures;
+    response.workers = worker_count;
+    response.queued = queue.size();
+
+    if (daemon_send(pending.sock, &response, sizeof(response), NULL, 0) == e_success && !payload.empty()) {
+        daemon_send(pending.sock, payload.data(), payload.size(), NULL, 0);
+    }
+    close(pending.sock);
+}
+
+void worker_loop() {
+    PendingRequest pending;
+    while (queue.pop(&pending)) {
+        serve_request(pending);
+    }
+}
+
+int listen_on(const char *socket_path) {
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (strlen(socket_path) >= sizeof(addr.sun_path)) {
+        fprintf(stderr, "ERROR: Socket path %s is too long\n", socket_path);
+        return -1;
+    }
+    strcpy(addr.sun_path, socket_path);
+
+    int sock = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (sock < 0) {
+        perror("socket");
+        return -1;
+    }
+    unlink(socket_path); // Stale socket from a previous run
+    if (bind(sock, (struct sockaddr *)&addr, sizeof(addr)) != 0 || listen(sock, 128) != 0) {
+        perror("bind/listen");
+        close(sock);
+        return -1;
+    }
+    chmod(socket_path, 0660); // Same user or group as the web workers
+    return sock;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    const char *socket_path = argc > 1 ? argv[1] : DAEMON_DEFAULT_SOCKET;
+    worker_count = std::thread::hardware_concurrency();
+    if (argc > 2) {
+        char *end = NULL;
+        errno = 0;
+        long workers = strtol(argv[2], &end, 10);
+        if (end == argv[2] || *end != '\0' || errno != 0 || workers < 1 || workers > MAX_WORKERS) {
+            fprintf(stderr, "Usage: stegd [socket_path] [workers]\n"
+                            "ERROR: workers must be a number from 1 to %d, got \"%s\"\n", MAX_WORKERS, argv[2]);
+            return 1;
+        }
+        worker_count = (uint32_t)workers;
+    }
+    if (worker_count == 0) {
+        worker_count = 1;
+    }
+
+    signal(SIGPIPE, SIG_IGN);
+    struct sigaction stop_action;
+    memset(&stop_action, 0, sizeof(stop_action));
+    stop_action.sa_handler = on_stop_signal; // No SA_RESTART, so accept() returns EINTR
+    sigaction(SIGINT, &stop_action, NULL);
+    sigaction(SIGTERM, &stop_action, NULL);
+
+    int listen_sock = listen_on(socket_path);
+    if (listen_sock < 0) {
+        return 1;
+    }
+
+    std::vector<std::thread> workers;
+    for (uint32_t i = 0; i < worker_count; ++i) {
+        workers.emplace_back(worker_loop);
+    }
+    fprintf(stdout, "LOG: stegd listening on %s with %u workers\n", socket_path, worker_count);
+    fflush(stdout);
+
+    while (!stop_requested) {
+        int sock = accept(listen_sock, NULL, NULL);
+        if (sock < 0) {
+            if (errno == EINTR) continue;
+            perror("accept");
+            break;
+        }
+        // A client that stops reading its response cannot hold a worker either
+        struct timeval send_timeout;
+        send_timeout.tv_sec = DAEMON_SEND_TIMEOUT_MS / 1000;
+        send_timeout.tv_usec = (DAEMON_SEND_TIMEOUT_MS % 1000) * 1000;
+        setsockopt(sock, SOL_SOCKET, SO_SNDTIMEO, &send_timeout, sizeof(send_timeout));
+        PendingRequest pending = {sock, Clock::now()};
+        queue.push(pending);
+    }
+
+    close(listen_sock);
+    unlink(socket_path);
+    queue.shutdown();
+    for (auto &worker : workers) {
+        worker.join();
+    }
+    fprintf(stdout, "LOG: stegd served %llu requests (%llu failed)\n",
+            (unsigned long long)total_requests.load(), (unsigned long long)total_failures.load());
+    return 0;
+}
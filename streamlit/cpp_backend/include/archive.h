@@ -0,0 +1,62 @@
+#ifndef ARCHIVE_H
+#define ARCHIVE_H
+
+#include "types.h"
+#include "common.h"
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+/* Archive mode: several files in one carrier
+ * The usual metadata is written with ARCHIVE_EXT as the extension, and the
+ * 4 byte size covers the whole archive body:
+ *   directory size (4) | entry count (4) |
+ *   per entry: name length (1) | name | size (4) | offset in the body (4) |
+ *   padding | entry data, each entry padded
+ * The directory and every entry start on a multiple of `align` body bytes
+ * (matrix_p bytes in matrix mode, i.e. a whole number of Hamming blocks,
+ * 1 otherwise), so an entry can be read by seeking straight to its samples.
+ * A decoder without archive support still recovers the body as a .stegarc file.
+ */
+#define ARCHIVE_EXT ".stegarc"
+#define ARCHIVE_HEADER_SIZE 8
+#define MAX_ARCHIVE_ENTRIES 4096
+#define MAX_ARCHIVE_NAME 255
+
+typedef struct _ArchiveEntry
+{
+    char name[MAX_ARCHIVE_NAME + 1];
+    uint size;
+    uint offset; // Start of the entry data, relative to the body
+} ArchiveEntry;
+
+typedef struct _ArchiveDirectory
+{
+    long body_start; // File offset of the first sample holding the body
+    uint body_size;
+    uint align;      // Body bytes per alignment unit, see above
+    std::vector<ArchiveEntry> entries;
+} ArchiveDirectory;
+
+/* Writes every secret file into one carrier in a single sequential pass
+ * Entries are named without their directories; two files with the same name are rejected
+ */
+Status do_archive_encoding(EncodeInfo *encInfo, const char **secret_fnames, int count,
+                           const char *magic_string_arg);
+
+/* Opens encInfo->stego_image_fname and reads the metadata and the directory
+ * only; the stego file stays open for extract_archive_entry
+ */
+Status open_archive(EncodeInfo *encInfo, const char *magic_string_arg, ArchiveDirectory *directory);
+
+// Seeks to the samples of one entry and writes its bytes to fptr_dest
+Status extract_archive_entry(EncodeInfo *encInfo, const ArchiveDirectory *directory, const ArchiveEntry *entry,
+                             FILE *fptr_dest);
+
+// Index of the entry called name, -1 if there is none
+int find_archive_entry(const ArchiveDirectory *directory, const char *name);
+
+// File offset of the sample holding body byte body_offset (a multiple of align)
+long get_archive_carrier_offset(const EncodeInfo *encInfo, const ArchiveDirectory *directory, uint body_offset);
+
+#endif
@@ -0,0 +1,135 @@
+#ifndef CARRIER_H
+#define CARRIER_H
+
+#include "types.h"
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+
+/* Carrier formats
+ * A carrier is a header that is copied unchanged, followed by a run of
+ * little-endian samples. The payload goes into the LSB of each sample,
+ * i.e. into the first byte of every sample.
+ *
+ * Each carrier type below provides, at compile time:
+ *   sample_bytes               bytes per sample
+ *   parse_header(fptr, info)   fills CarrierInfo from the file header
+ *   capacity_bits(info)        number of samples available for payload bits
+ *   lsb(span, i)               byte holding the LSB of sample i in a span
+ * The embed/extract kernels are templates over these types, so the
+ * carrier is chosen once per call and never inside the bit loop.
+ */
+
+typedef enum
+{
+    e_carrier_bmp,       // 24-bit BMP, every byte after the 54 byte header
+    e_carrier_wav_pcm8,  // PCM WAV, 8 bits per sample
+    e_carrier_wav_pcm16  // PCM WAV, 16 bits per sample
+} CarrierType;
+
+typedef struct _CarrierInfo
+{
+    CarrierType type;
+    long data_offset; // Bytes before the first sample (copied unchanged)
+    long data_size;   // Bytes of sample data
+} CarrierInfo;
+
+template <uint Bytes>
+struct SampleLayout
+{
+    enum { sample_bytes = Bytes };
+
+    static inline long capacity_bits(const CarrierInfo *info)
+    {
+        return info->data_size / Bytes;
+    }
+
+    static inline uint8_t &lsb(uint8_t *span, size_t i)
+    {
+        return span[i * Bytes];
+    }
+
+    static inline uint8_t lsb(const uint8_t *span, size_t i)
+    {
+        return span[i * Bytes];
+    }
+};
+
+struct BmpCarrier : SampleLayout<1>
+{
+    static Status parse_header(FILE *fptr, CarrierInfo *info);
+};
+
+template <uint Bytes>
+struct PcmWavCarrier : SampleLayout<Bytes>
+{
+    static Status parse_header(FILE *fptr, CarrierInfo *info);
+};
+
+/* Read-back check of freshly embedded samples
+ * The kernels extract each block again from the buffer they just modified,
+ * before it is written, and compare it with the payload.
+ */
+typedef struct _EmbedVerify
+{
+    long checked;      // Payload bytes read back
+    long mismatches;   // Payload bytes that read back differently
+    uint32_t checksum; // CRC-32 of the payload as read back from the samples
+} EmbedVerify;
+
+uint32_t crc32_update(uint32_t crc, const uint8_t *data, size_t size);
+
+// Adds one block of read-back payload to verify
+inline void verify_readback(EmbedVerify *verify, const uint8_t *expected, const uint8_t *readback, size_t size)
+{
+    for (size_t j = 0; j < size; ++j)
+    {
+        verify->mismatches += expected[j] != readback[j];
+    }
+    verify->checked += (long)size;
+    verify->checksum = crc32_update(verify->checksum, readback, size);
+}
+
+// Embeds `size` bytes, LSB first, into the LSBs of size * 8 samples of span
+template <class Carrier>
+inline void embed_span(uint8_t *span, const uint8_t *data, size_t size)
+{
+    for (size_t j = 0; j < size; ++j)
+    {
+        for (uint i = 0; i < 8; ++i)
+        {
+            uint8_t &byte = Carrier::lsb(span, j * 8 + i);
+            byte = (uint8_t)((byte & ~1u) | ((data[j] >> i) & 1u));
+        }
+    }
+}
+
+template <class Carrier>
+inline void extract_span(const uint8_t *span, uint8_t *dest, size_t size)
+{
+    for (size_t j = 0; j < size; ++j)
+    {
+        uint8_t byte = 0;
+        for (uint i = 0; i < 8; ++i)
+        {
+            byte |= (uint8_t)((Carrier::lsb(span, j * 8 + i) & 1u) << i);
+        }
+        dest[j] = byte;
+    }
+}
+
+// Detects the carrier format from its header; leaves fptr at the start of the file
+Status parse_carrier_header(FILE *fptr, CarrierInfo *info);
+// The same detection without reporting an error, for callers that skip unsupported files
+Status probe_carrier_header(FILE *fptr, CarrierInfo *info);
+Status copy_carrier_header(FILE *fptr_src, FILE *fptr_dest, const CarrierInfo *info);
+long get_carrier_capacity_bits(const CarrierInfo *info);
+uint get_carrier_sample_bytes(CarrierType type);
+
+// Plain LSB kernels: move size * 8 samples from src to stego / read them from stego
+// verify may be NULL; otherwise every block is read back before it is written
+Status embed_to_carrier(CarrierType type, const char *data, int size, FILE *fptr_src, FILE *fptr_stego,
+                        EmbedVerify *verify = NULL);
+Status extract_from_carrier(CarrierType type, int size, FILE *fptr_stego, char *dest);
+
+#endif
@@ -2,6 +2,8 @@
 #define COMMON_H
 
 #include "types.h" // Contains user defined types
+#include "carrier.h" // CarrierInfo
+#include "steg_log.h" // steg_log / steg_error
 // #include "common.h" // Redundant self-include
 #include <cstdint> // Use <cstdint> instead of <stdint.h>
 #include <cstdio>  // Use <cstdio> instead of <stdio.h>
@@ -9,10 +11,41 @@
 #include <cstring> // Use <cstring> instead of <string.h>
 #include <cstdlib> // Use <cstdlib> instead of <stdlib.h>
 #include <ctime>   // Use <ctime> instead of <time.h>
+#include <atomic>
 
 // _POSIX_C_SOURCE might not be needed if not using highly specific POSIX features directly in headers
 // #define _POSIX_C_SOURCE 200809L
 
+/* Secret bytes handled per block by encode_secret_file_data and
+ * decode_secret_data; progress and cancellation are checked between blocks
+ */
+#define STEG_BLOCK_SIZE (64 * 1024)
+#define STEG_PROGRESS_INTERVAL (1024 * 1024)
+
+/* The extension size byte of the metadata also records matrix_p, so a decode
+ * with the wrong parameter fails instead of returning garbage:
+ *   bits 0-4: extension size, at most MAX_EXT_SIZE
+ *   bits 5-7: matrix_p - 1 in matrix mode, 0 for plain LSB
+ * Carriers written before matrix embedding read back as plain LSB.
+ */
+#define MAX_EXT_SIZE 20
+#define EXT_SIZE_MASK 0x1F
+#define EXT_MATRIX_SHIFT 5
+
+typedef void (*ProgressFn)(void *ctx, long done, long total);
+
+// Optional progress reporting and cooperative cancellation for one job
+typedef struct _StegControl
+{
+    ProgressFn progress;          // May be NULL
+    void *progress_ctx;
+    long progress_interval;       // Secret bytes between progress calls, 0 for the default
+    std::atomic<bool> *cancelled; // May be NULL; set from any thread to stop the job
+    long done;                    // Secret bytes processed so far
+    long total;                   // Secret bytes in this job
+    long next_report;
+} StegControl;
+
 typedef struct _EncodeInfo
 {
     /* Source Image info */
@@ -20,6 +53,10 @@ typedef struct _EncodeInfo
     FILE *fptr_src_image;
     uint image_capacity; // Calculated, not directly set by Python
     uint bits_per_pixel; // Usually 24 for BMP, can be assumed or derived
+    CarrierInfo carrier; // Parsed from the source (encode) or stego (decode) header
+    uint8_t carrier_parsed; // Set when the caller already filled in carrier (e.g. from a CarrierPool)
+    StegControl *control; // Optional progress/cancellation, may be NULL
+    EmbedVerify *verify;  // Optional read-back check of every embedded block, may be NULL
 
     /* Secret File Info */
     char *secret_fname;
@@ -29,6 +66,7 @@ typedef struct _EncodeInfo
     uint8_t ext_size;      // Derived from secret_fname
     char *ext;             // Derived from secret_fname
     long size_secret_file; // Derived from secret_fname
+    uint8_t matrix_p;      // 0 for plain LSB, else Hamming code parameter for the secret data (see matrix.h)
 
     /* Stego Image Info */
     char *stego_image_fname;
@@ -45,4 +83,17 @@ typedef struct _EncodeInfo
 // void clear_screen_c(); // Remove for library
 char *int_to_str(uint num);
 uint str_to_int(const char* data); // Add const
+
+void steg_progress_start(StegControl *control, long total);
+Status steg_progress(StegControl *control, long bytes); // e_failure once the job is cancelled
+Status steg_check_cancelled(StegControl *control);      // The same check, without reporting progress
+
+// Extension of a secret file name with its leading dot (".txt"), "" if it has none
+const char *secret_file_extension(const char *fname);
+// 1 to MAX_EXT_SIZE characters: the extensions decode_file_extension reads back
+bool valid_secret_extension(const char *ext);
+
+uint8_t pack_ext_size(uint8_t ext_size, uint8_t matrix_p);
+// Splits a packed extension size byte; fails if it was written with another matrix_p
+Status unpack_ext_size(uint8_t packed, uint8_t matrix_p, uint8_t *ext_size);
 #endif
\ No newline at end of file
@@ -0,0 +1,92 @@
+#ifndef DAEMON_H
+#define DAEMON_H
+
+#include "types.h"
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+/* Wire protocol of the stegd Unix-socket daemon
+ * One request per connection: the client sends a DaemonRequest (with up to
+ * DAEMON_MAX_FDS file descriptors attached through SCM_RIGHTS), followed by
+ * magic_len bytes of magic string and inline_len bytes of inline payload.
+ * The daemon answers with a DaemonResponse followed by payload_len bytes.
+ *
+ *   op               fds                          inline payload
+ *   e_daemon_encode  src, secret, stego           -
+ *   e_daemon_encode  src, stego                   secret bytes (ext in request)
+ *   e_daemon_decode  stego, dest                  -
+ *   e_daemon_decode  stego                        secret bytes returned inline
+ *   e_daemon_probe   stego                        -
+ *   e_daemon_stats   -                            -
+ */
+#define DAEMON_PROTOCOL_MAGIC 0x53544744u // "STGD"
+#define DAEMON_DEFAULT_SOCKET "/tmp/stegd.sock"
+#define DAEMON_MAX_FDS 3
+#define DAEMON_EXT_SIZE 24
+#define DAEMON_MESSAGE_SIZE 128
+#define DAEMON_MAX_INLINE (100u * 1024 * 1024)
+// A client has this long to send its whole request, and each response write may block this long
+#define DAEMON_REQUEST_TIMEOUT_MS 30000
+#define DAEMON_SEND_TIMEOUT_MS 30000
+
+typedef enum
+{
+    e_daemon_encode,
+    e_daemon_decode,
+    e_daemon_probe,
+    e_daemon_stats
+} DaemonOp;
+
+typedef struct _DaemonRequest
+{
+    uint32_t protocol_magic;
+    uint32_t op;         // DaemonOp
+    uint32_t matrix_p;   // 0 for plain LSB
+    uint32_t fd_count;   // Descriptors attached to this message
+    uint32_t magic_len;  // Magic string bytes following the request
+    uint32_t inline_len; // Inline secret bytes following the magic string
+    char ext[DAEMON_EXT_SIZE]; // Extension of an inline secret, e.g. ".txt"
+} DaemonRequest;
+
+typedef struct _DaemonResponse
+{
+    uint32_t protocol_magic;
+    uint32_t status;      // Status
+    uint32_t carrier;     // CarrierType of the carrier that was processed
+    uint32_t payload_len; // Inline bytes following the response
+    uint64_t secret_size;
+    uint64_t capacity_bits;
+    // Per-request stats
+    uint64_t queue_us;    // Time between accept and a worker picking the request up
+    uint64_t run_us;      // Time spent in the engine
+    uint64_t bytes_in;    // Carrier + secret bytes read
+    uint64_t bytes_out;   // Stego or secret bytes written
+    // Daemon-wide stats, filled for every response
+    uint64_t total_requests;
+    uint64_t total_failures;
+    uint32_t workers;
+    uint32_t queued;
+    char ext[DAEMON_EXT_SIZE];
+    char message[DAEMON_MESSAGE_SIZE];
+} DaemonResponse;
+
+#ifndef _WIN32
+// Both helpers loop over short reads/writes; fds are sent with the first byte
+Status daemon_send(int sock, const void *data, size_t size, const int *fds, int fd_count);
+Status daemon_recv(int sock, void *data, size_t size, int *fds, int *fd_count);
+/* Like daemon_recv, but fails once the read has taken *budget_ms; the time
+ * spent is taken off *budget_ms, so one budget can cover several reads
+ */
+Status daemon_recv_within(int sock, void *data, size_t size, int *fds, int *fd_count, long *budget_ms);
+
+int daemon_connect(const char *socket_path);
+
+// Client side of one round trip: request + magic + inline payload out, response + payload in
+Status daemon_call(const char *socket_path, const DaemonRequest *request, const int *fds,
+                   const std::string &magic, const std::vector<char> &inline_data,
+                   DaemonResponse *response, std::vector<char> *payload);
+#endif
+
+#endif
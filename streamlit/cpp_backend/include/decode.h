@@ -4,6 +4,7 @@
 #include "common.h"
 
 Status open_decode_files(EncodeInfo *encInfo); // Only opens stego image for reading
+Status skip_carrier_header(EncodeInfo *encInfo); // Parses the carrier header and seeks to the first sample
 uint8_t decode_magic_size(EncodeInfo *encInfo); // Internal helper
 
 // Pass magic string as parameter
@@ -20,4 +21,13 @@ int secret_data_size(EncodeInfo *encInfo); // Internal helper
 Status decode_data_from_image(int size, FILE *fptr_stego_image, char *dest);
 Status decode_secret_data(EncodeInfo *encInfo); // Internal helper
 
+// Receives each decoded chunk; returning e_failure stops the decode
+typedef Status (*ChunkSinkFn)(void *ctx, const char *data, int size);
+
+/* Decodes data_size secret bytes (read with secret_data_size) in chunks of
+ * chunk_size bytes, rounded down to whole Hamming blocks in matrix mode, and
+ * hands every chunk to sink; decode_secret_data uses it with a file sink
+ */
+Status decode_secret_chunks(EncodeInfo *encInfo, int data_size, int chunk_size, ChunkSinkFn sink, void *sink_ctx);
+
 #endif
\ No newline at end of file
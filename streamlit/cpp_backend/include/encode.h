@@ -9,7 +9,9 @@
 
 Status do_encoding(EncodeInfo *encInfo, const char *magic_string_arg);
 Status open_files(EncodeInfo *encInfo);
+void close_encode_files(EncodeInfo *encInfo);
 Status check_capacity(EncodeInfo *encInfo);
+long get_required_capacity_bits(uint8_t magic_size, uint8_t ext_size, long secret_size, uint8_t matrix_p);
 uint get_image_size_for_bmp(FILE *fptr_image);
 uint get_file_size(FILE *fptr);
 Status copy_bmp_header(FILE *fptr_src_image, FILE *fptr_dest_image);
@@ -19,6 +21,7 @@ Status encode_secret_file_extn_size(uint8_t ext_size, EncodeInfo *encInfo);
 Status encode_secret_file_size(long file_size, EncodeInfo *encInfo);
 Status encode_secret_file_data(EncodeInfo *encInfo);
 Status encode_data_to_image(const char *data, int size, FILE *fptr_src_image, FILE *fptr_stego_image); // Takes const char*
-Status copy_remaining_img_data(FILE *fptr_src, FILE *fptr_dest);
+// Copies the rest of the carrier from fptr_src_image to fptr_stego_image, checking for cancellation between blocks
+Status copy_remaining_img_data(EncodeInfo *encInfo);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,64 @@
+#ifndef MATRIX_H
+#define MATRIX_H
+
+#include "types.h"
+#include "carrier.h"
+#include <cstdint>
+#include <cstdio>
+
+/* Matrix embedding with the Hamming code (1, 2^p - 1, p)
+ * The payload is cut into groups of p bits. Each group is hidden in a block
+ * of n = 2^p - 1 carrier bytes by flipping at most one LSB, so that the
+ * syndrome of the block (XOR of the 1 based positions whose LSB is set)
+ * equals the group. Plain LSB may change one carrier byte per payload bit,
+ * matrix embedding changes at most one carrier byte per p payload bits.
+ */
+#define MATRIX_MIN_P 2
+#define MATRIX_MAX_P 8
+
+// A block is n consecutive carrier samples; Carrier::lsb picks the byte holding each LSB
+template <class Carrier, uint P>
+struct HammingKernel
+{
+    enum { n = (1u << P) - 1, mask = (1u << P) - 1, block_bytes = n * Carrier::sample_bytes };
+
+    // Written as a plain XOR reduction so the compiler can vectorize it
+    static inline uint syndrome(const uint8_t *block)
+    {
+        uint s = 0;
+        for (uint i = 0; i < n; ++i)
+        {
+            s ^= (Carrier::lsb(block, i) & 1u) * (i + 1);
+        }
+        return s;
+    }
+
+    static inline void embed(uint8_t *block, uint bits)
+    {
+        uint flip = syndrome(block) ^ (bits & mask);
+        if (flip)
+        {
+            Carrier::lsb(block, flip - 1) ^= 1;
+        }
+    }
+
+    static inline uint extract(const uint8_t *block)
+    {
+        return syndrome(block);
+    }
+};
+
+// Carrier samples needed to hide `size` payload bytes with parameter p
+long get_matrix_carrier_size(long size, uint p);
+
+Status encode_data_to_image_matrix(const char *data, int size, uint p, CarrierType carrier,
+                                   FILE *fptr_src_image, FILE *fptr_stego_image, EmbedVerify *verify = NULL);
+Status decode_data_from_image_matrix(int size, uint p, CarrierType carrier, FILE *fptr_stego_image, char *dest);
+
+/* Same kernels on a carrier already in memory (e.g. a video frame, see video.h);
+ * span holds get_matrix_carrier_size(size, p) samples
+ */
+Status embed_span_matrix(CarrierType carrier, uint8_t *span, const char *data, int size, uint p);
+Status extract_span_matrix(CarrierType carrier, const uint8_t *span, int size, uint p, char *dest);
+
+#endif
@@ -0,0 +1,51 @@
+#ifndef POOL_H
+#define POOL_H
+
+#include "types.h"
+#include "common.h"
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+/* Carrier pool
+ * Every carrier in a directory is mapped into memory and its header parsed
+ * once, at load time. The entries are kept sorted by capacity, so picking
+ * the smallest carrier that fits a payload is a binary search, and encoding
+ * reads the carrier from memory instead of opening and parsing it again.
+ * A loaded pool is read-only and can be shared by concurrent encodes.
+ */
+
+typedef struct _PooledCarrier
+{
+    char *path;
+    CarrierInfo info;
+    long capacity_bits;  // Payload samples, see get_carrier_capacity_bits
+    const uint8_t *data; // Whole file contents, mapped read-only
+    size_t size;
+} PooledCarrier;
+
+typedef struct _CarrierPool
+{
+    std::vector<PooledCarrier> carriers; // Ascending capacity_bits
+} CarrierPool;
+
+#ifndef _WIN32
+// Maps every supported carrier in dir_path; files that are not BMP/WAV carriers are skipped
+Status carrier_pool_load(CarrierPool *pool, const char *dir_path);
+void carrier_pool_free(CarrierPool *pool);
+
+// Smallest carrier with at least needed_bits of capacity, NULL if none fits
+const PooledCarrier *carrier_pool_best_fit(const CarrierPool *pool, long needed_bits);
+
+// Read-only stream over the pooled bytes, to be used as fptr_src_image
+FILE *carrier_pool_open(const PooledCarrier *carrier);
+
+/* Encodes encInfo->secret_fname into encInfo->stego_image_fname using the
+ * best fitting pooled carrier (returned in *used)
+ */
+Status carrier_pool_encode(const CarrierPool *pool, EncodeInfo *encInfo, const char *magic_string_arg,
+                           const PooledCarrier **used);
+#endif
+
+#endif
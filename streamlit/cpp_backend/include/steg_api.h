@@ -0,0 +1,89 @@
+#ifndef STEG_API_H
+#define STEG_API_H
+
+/* Stable C API of the steganography engine (libsteg)
+ * Plain C, usable from C, Go (cgo) or any FFI. Every call returns a
+ * steg_status; a context carries the options of its jobs and the message
+ * of its last failure. The library never prints: diagnostics go to the
+ * callback set with steg_set_log_callback, if any.
+ * A context must not be used by two threads at once; separate contexts
+ * can run jobs in parallel.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// The library is built with -fvisibility=hidden; only these symbols are exported
+#if defined(__GNUC__) && !defined(_WIN32)
+#define STEG_API __attribute__((visibility("default")))
+#else
+#define STEG_API
+#endif
+
+#define STEG_API_VERSION 2
+
+typedef enum
+{
+    STEG_OK = 0,
+    STEG_ERR_INVALID_ARGUMENT = 1,
+    STEG_ERR_IO = 2,                  // A file could not be opened, read or written
+    STEG_ERR_UNSUPPORTED_CARRIER = 3, // Not a BMP image or 8/16-bit PCM WAV file
+    STEG_ERR_CAPACITY = 4,            // The secret does not fit the carrier
+    STEG_ERR_MAGIC = 5,               // The magic string does not match
+    STEG_ERR_VERIFY = 6,              // Verification found mismatched bytes
+    STEG_ERR_CANCELLED = 7,
+    STEG_ERR_FAILED = 8,              // Any other engine failure
+    STEG_ERR_NO_MEMORY = 9,
+    STEG_ERR_BUFFER_TOO_SMALL = 10    // out_path cannot hold the output path (since version 2)
+} steg_status;
+
+typedef struct steg_context steg_context; // Opaque
+
+typedef void (*steg_log_fn)(void *user_data, int is_error, const char *message);
+typedef void (*steg_progress_fn)(void *user_data, long done, long total);
+
+STEG_API int steg_api_version(void);
+STEG_API const char *steg_status_string(steg_status status);
+
+// Process-wide; install before starting jobs. NULL (the default) discards all diagnostics.
+STEG_API void steg_set_log_callback(steg_log_fn callback, void *user_data);
+
+STEG_API steg_status steg_context_new(steg_context **out);
+STEG_API void steg_context_free(steg_context *ctx);
+
+// Options, kept for every following job of the context
+STEG_API steg_status steg_set_matrix_p(steg_context *ctx, int matrix_p); // 0 or 2..8
+STEG_API steg_status steg_set_verify(steg_context *ctx, int verify);
+STEG_API steg_status steg_set_progress(steg_context *ctx, steg_progress_fn callback, void *user_data,
+                                       long interval_bytes);
+
+// Thread-safe; stops the context's running job at its next block, or the next job if none is running
+STEG_API void steg_cancel(steg_context *ctx);
+
+STEG_API steg_status steg_encode(steg_context *ctx, const char *src_path, const char *secret_path,
+                                 const char *stego_path, const char *magic);
+
+/* Writes the secret to output_base + its stored extension; the full path is
+ * copied to out_path unless that is NULL. If the path does not fit in
+ * out_path_size bytes nothing is decoded: the call returns
+ * STEG_ERR_BUFFER_TOO_SMALL, out_path gets "" and steg_last_output_path
+ * holds the path (strlen + 1 bytes are needed).
+ */
+STEG_API steg_status steg_decode(steg_context *ctx, const char *stego_path, const char *output_base,
+                                 const char *magic, char *out_path, size_t out_path_size);
+
+// Results of the context's last job
+STEG_API const char *steg_last_error(const steg_context *ctx); // "" after a success
+STEG_API uint32_t steg_last_checksum(const steg_context *ctx); // CRC-32 of the secret when verify is on
+STEG_API long steg_last_mismatches(const steg_context *ctx);
+STEG_API const char *steg_last_output_path(const steg_context *ctx); // Of steg_decode, "" if none
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,29 @@
+#ifndef STEG_LOG_H
+#define STEG_LOG_H
+
+/* Engine diagnostics
+ * steg_log carries the LOG/progress lines and steg_error the ERROR lines of
+ * the engine. By default they go to stdout/stderr like before; once a
+ * handler is installed they go to the handler instead. The standalone
+ * library (built with STEG_LIBRARY) never writes to stdio.
+ * The last error reported on each thread is kept for the C API.
+ */
+typedef void (*StegLogFn)(void *ctx, int is_error, const char *message);
+
+// Install before starting jobs; NULL restores the default
+void steg_set_log_handler(StegLogFn handler, void *ctx);
+
+#if defined(__GNUC__)
+#define STEG_PRINTF_FORMAT __attribute__((format(printf, 1, 2)))
+#else
+#define STEG_PRINTF_FORMAT
+#endif
+
+void steg_log(const char *format, ...) STEG_PRINTF_FORMAT;
+void steg_error(const char *format, ...) STEG_PRINTF_FORMAT;
+
+// Last steg_error message of the calling thread, without the trailing newline
+const char *steg_last_thread_error(void);
+void steg_clear_thread_error(void);
+
+#endif
@@ -0,0 +1,38 @@
+#ifndef STRIPE_H
+#define STRIPE_H
+
+#include "types.h"
+#include "common.h"
+#include <cstdint>
+#include <cstdio>
+
+/* Every striped carrier stores, after the magic string and extension,
+ * a 16 byte stripe header followed by the usual 4 byte size and the data:
+ *   index (4) | count (4) | offset in the secret (4) | total secret size (4)
+ */
+#define STRIPE_HEADER_SIZE 16
+#define MAX_STRIPES 255
+
+typedef struct _StripeInfo
+{
+    uint index;      // Position of this stripe in the set (0 based)
+    uint count;      // Number of stripes in the set
+    uint offset;     // Offset of this stripe's bytes in the secret
+    uint total_size; // Size of the whole secret
+    uint length;     // Number of secret bytes carried by this stripe
+} StripeInfo;
+
+// Splits the secret across `count` carriers and encodes all stripes in parallel
+Status do_striped_encoding(const char **src_image_fnames, const char **stego_image_fnames, int count,
+                           const char *secret_fname, const char *magic_string_arg);
+
+// Accepts the stego images in any order, checks that the set is complete and
+// reassembles the stripes in parallel into output_base_path + extension
+Status do_striped_decoding(const char **stego_image_fnames, int count, const char *magic_string_arg,
+                           const char *output_base_path, char **output_path);
+
+Status encode_stripe_header(const StripeInfo *stripe, EncodeInfo *encInfo);
+Status decode_stripe_header(EncodeInfo *encInfo, StripeInfo *stripe);
+uint get_stripe_capacity(FILE *fptr_src_image, uint8_t magic_size, uint8_t ext_size);
+
+#endif
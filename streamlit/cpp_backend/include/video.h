@@ -0,0 +1,58 @@
+#ifndef VIDEO_H
+#define VIDEO_H
+
+#include "types.h"
+#include "common.h"
+#include <cstdint>
+#include <cstdio>
+
+/* Video carrier: uncompressed YUV4MPEG2 (.y4m) with 8-bit samples
+ * The stream header and every FRAME line are copied unchanged; every byte of
+ * a frame's planes is a sample, used like the pixel bytes of a BMP.
+ * The secret is spread evenly over the frames, one chunk per frame:
+ *   frame 0:    magic size (1) | magic | ext size (1) | ext | secret size (4) | frames used (4)
+ *   every used frame: offset in the secret (4) | chunk length (4) | chunk
+ * Metadata and frame headers are plain LSB; chunks use matrix embedding when
+ * matrix_p is set, each one a whole number of Hamming blocks but the last.
+ * The ext size byte records matrix_p as well (see pack_ext_size in common.h).
+ * Frames go through a pipeline: a reader thread, N embed/extract workers and
+ * the calling thread writing them back in order, with at most max_in_flight
+ * frames in memory.
+ */
+#define Y4M_SIGNATURE "YUV4MPEG2 "
+#define Y4M_FRAME_TAG "FRAME"
+#define MAX_Y4M_LINE 1024
+#define MAX_Y4M_DIMENSION 16384
+#define VIDEO_FRAME_HEADER_SIZE 8
+
+typedef struct _Y4mInfo
+{
+    uint width;
+    uint height;
+    long header_size; // Bytes of the stream header line, '\n' included
+    long frame_size;  // Sample bytes of one frame, all planes
+    long frame_count;
+} Y4mInfo;
+
+typedef struct _VideoOptions
+{
+    uint workers;       // Embed/extract threads, 0 for one per core
+    uint max_in_flight; // Frames held in memory at once, 0 for two per worker
+} VideoOptions;
+
+// Reads the stream header and counts the frames; leaves fptr at the first FRAME line
+Status parse_y4m_header(FILE *fptr, Y4mInfo *info);
+
+// Secret bytes one frame can carry (the same for every frame)
+long get_video_frame_capacity(const Y4mInfo *info, uint8_t magic_size, uint8_t ext_size, uint8_t matrix_p);
+
+// Opens src_image_fname, secret_fname and stego_image_fname of encInfo itself; removes the stego video on failure
+Status do_video_encoding(EncodeInfo *encInfo, const char *magic_string_arg, const VideoOptions *options);
+
+/* Opens encInfo->stego_image_fname and writes the secret to output_base_path
+ * + its extension; *output_path receives that path (malloc'ed)
+ */
+Status do_video_decoding(EncodeInfo *encInfo, const char *magic_string_arg, const char *output_base_path,
+                         char **output_path, const VideoOptions *options);
+
+#endif
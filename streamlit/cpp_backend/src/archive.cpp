@@ -0,0 +1,319 @@
+// archive.cpp
+#include "archive.h"
+#include "encode.h"
+#include "decode.h"
+#include "matrix.h"
+#include "carrier.h"
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace {
+
+// Largest directory MAX_ARCHIVE_ENTRIES entries can need
+const uint MAX_DIRECTORY_SIZE = ARCHIVE_HEADER_SIZE + MAX_ARCHIVE_ENTRIES * (1 + MAX_ARCHIVE_NAME + 8);
+
+uint align_up(uint size, uint align) {
+    return (size + align - 1) / align * align;
+}
+
+// Archive bytes per kernel call, a whole number of alignment units
+uint archive_block_size(uint align) {
+    return STEG_BLOCK_SIZE - STEG_BLOCK_SIZE % align;
+}
+
+// File name without its directories, as stored in the archive directory
+const char *entry_name(const char *fname) {
+    const char *name = fname;
+    for (const char *p = fname; *p; ++p) {
+        if (*p == '/' || *p == '\\') {
+            name = p + 1;
+        }
+    }
+    return name;
+}
+
+void put_uint(std::vector<char> *out, uint value) {
+    char *bytes = int_to_str(value);
+    out->insert(out->end(), bytes, bytes + 4);
+    free(bytes);
+}
+
+Status embed_payload(EncodeInfo *encInfo, const char *data, int size) {
+    if (encInfo->matrix_p) {
+        return encode_data_to_image_matrix(data, size, encInfo->matrix_p, encInfo->carrier.type,
+                                           encInfo->fptr_src_image, encInfo->fptr_stego_image, encInfo->verify);
+    }
+    return embed_to_carrier(encInfo->carrier.type, data, size,
+                            encInfo->fptr_src_image, encInfo->fptr_stego_image, encInfo->verify);
+}
+
+Status extract_payload(EncodeInfo *encInfo, int size, char *dest) {
+    if (encInfo->matrix_p) {
+        return decode_data_from_image_matrix(size, encInfo->matrix_p, encInfo->carrier.type,
+                                             encInfo->fptr_stego_image, dest);
+    }
+    return extract_from_carrier(encInfo->carrier.type, size, encInfo->fptr_stego_image, dest);
+}
+
+// Streams one secret file into the carrier, padded to a whole number of alignment units
+Status embed_entry(EncodeInfo *encInfo, const char *fname, const ArchiveEntry *entry, uint align,
+                   std::vector<char> *buffer) {
+    FILE *fptr_secret = fopen(fname, "rb");
+    if (!fptr_secret) {
+        steg_error("ERROR: Unable to open file %s\n", fname);
+        return e_failure;
+    }
+    Status status = e_success;
+    for (uint done = 0; done < entry->size && status == e_success;) {
+        uint chunk = entry->size - done < buffer->size() ? entry->size - done : (uint)buffer->size();
+        if (fread(buffer->data(), 1, chunk, fptr_secret) != chunk) {
+            steg_error("ERROR: %s changed while it was being archived!\n", fname);
+            status = e_failure;
+            break;
+        }
+        uint padded = align_up(chunk, align);
+        memset(buffer->data() + chunk, 0, padded - chunk);
+        status = embed_payload(encInfo, buffer->data(), padded);
+        done += chunk;
+        if (status == e_success) {
+            status = steg_progress(encInfo->control, padded);
+        }
+    }
+    fclose(fptr_secret);
+    return status;
+}
+
+} // namespace
+
+Status do_archive_encoding(EncodeInfo *encInfo, const char **secret_fnames, int count,
+                           const char *magic_string_arg) {
+    if (!encInfo || !secret_fnames || !magic_string_arg || count <= 0 || count > MAX_ARCHIVE_ENTRIES ||
+        strlen(magic_string_arg) == 0 || strlen(magic_string_arg) >= sizeof(encInfo->MAGIC_STRING)) {
+        steg_error("ERROR: Invalid arguments to do_archive_encoding.\n");
+        return e_failure;
+    }
+    uint align = encInfo->matrix_p ? encInfo->matrix_p : 1;
+
+    // The directory is laid out up front from the file sizes, so the body is written in one pass
+    std::vector<ArchiveEntry> entries(count);
+    uint directory_size = ARCHIVE_HEADER_SIZE;
+    for (int i = 0; i < count; ++i) {
+        const char *name = entry_name(secret_fnames[i]);
+        size_t name_len = strlen(name);
+        if (name_len == 0 || name_len > MAX_ARCHIVE_NAME) {
+            steg_error("ERROR: Invalid archive entry name %s\n", secret_fnames[i]);
+            return e_failure;
+        }
+        // Directories are dropped from the names, so a/x.txt and b/x.txt would collide
+        for (int j = 0; j < i; ++j) {
+            if (strcmp(entries[j].name, name) == 0) {
+                steg_error("ERROR: %s and %s would both be stored as %s\n", secret_fnames[j], secret_fnames[i], name);
+                return e_failure;
+            }
+        }
+        FILE *fptr = fopen(secret_fnames[i], "rb");
+        if (!fptr) {
+            steg_error("ERROR: Unable to open file %s\n", secret_fnames[i]);
+            return e_failure;
+        }
+        entries[i].size = get_file_size(fptr);
+        fclose(fptr);
+        memcpy(entries[i].name, name, name_len + 1);
+        directory_size += 1 + (uint)name_len + 8;
+    }
+    directory_size = align_up(directory_size, align);
+    unsigned long long body_size = directory_size;
+    for (int i = 0; i < count; ++i) {
+        entries[i].offset = (uint)body_size;
+        body_size += align_up(entries[i].size, align);
+        if (body_size > INT32_MAX) {
+            steg_error("ERROR: The archive is too large!\n");
+            return e_failure;
+        }
+    }
+
+    std::vector<char> directory;
+    put_uint(&directory, directory_size);
+    put_uint(&directory, (uint)count);
+    for (int i = 0; i < count; ++i) {
+        uint8_t name_len = static_cast<uint8_t>(strlen(entries[i].name));
+        directory.push_back(static_cast<char>(name_len));
+        directory.insert(directory.end(), entries[i].name, entries[i].name + name_len);
+        put_uint(&directory, entries[i].size);
+        put_uint(&directory, entries[i].offset);
+    }
+    directory.resize(directory_size, 0);
+
+    encInfo->fptr_src_image = fopen(encInfo->src_image_fname, "rb");
+    encInfo->fptr_stego_image = encInfo->fptr_src_image ? fopen(encInfo->stego_image_fname, "wb") : NULL;
+    if (!encInfo->fptr_src_image || !encInfo->fptr_stego_image) {
+        steg_error("ERROR: Unable to open the source or stego file\n");
+        close_encode_files(encInfo);
+        return e_failure;
+    }
+    if (parse_carrier_header(encInfo->fptr_src_image, &encInfo->carrier) == e_failure) {
+        close_encode_files(encInfo);
+        return e_failure;
+    }
+    uint8_t ext_size = static_cast<uint8_t>(strlen(ARCHIVE_EXT));
+    long needed = get_required_capacity_bits(static_cast<uint8_t>(strlen(magic_string_arg)), ext_size,
+                                             (long)body_size, encInfo->matrix_p);
+    long available = get_carrier_capacity_bits(&encInfo->carrier);
+    steg_log("the capacity of the carrier is %ld bits, the archive needs %ld\n", available, needed);
+    if (needed < 0 || needed > available) {
+        steg_log("the archive is too big\n");
+        close_encode_files(encInfo);
+        return e_failure;
+    }
+
+    std::vector<char> buffer(archive_block_size(align));
+    steg_progress_start(encInfo->control, (long)body_size);
+    Status status = e_success;
+    if (copy_carrier_header(encInfo->fptr_src_image, encInfo->fptr_stego_image, &encInfo->carrier) == e_failure ||
+        encode_magic_string(encInfo, magic_string_arg) == e_failure ||
+        encode_secret_file_extn_size(ext_size, encInfo) == e_failure ||
+        encode_secret_file_extn(ARCHIVE_EXT, encInfo) == e_failure ||
+        encode_secret_file_size((long)body_size, encInfo) == e_failure ||
+        embed_payload(encInfo, directory.data(), (int)directory.size()) == e_failure ||
+        steg_progress(encInfo->control, (long)directory.size()) == e_failure) {
+        status = e_failure;
+    }
+    for (int i = 0; i < count && status == e_success; ++i) {
+        if (entries[i].size > 0) {
+            status = embed_entry(encInfo, secret_fnames[i], &entries[i], align, &buffer);
+        }
+    }
+    if (status == e_success) {
+        status = copy_remaining_img_data(encInfo);
+    }
+    if (status == e_success && encInfo->verify && encInfo->verify->mismatches > 0) {
+        steg_error("ERROR: Verification failed, %ld embedded bytes read back differently!\n",
+                   encInfo->verify->mismatches);
+        status = e_failure;
+    }
+    close_encode_files(encInfo);
+    if (status == e_failure) {
+        steg_error("ERROR: Failed to encode the archive.\n");
+        return e_failure;
+    }
+    steg_log("LOG: archived %d files (%llu bytes) into %s\n", count, body_size, encInfo->stego_image_fname);
+    return e_success;
+}
+
+Status open_archive(EncodeInfo *encInfo, const char *magic_string_arg, ArchiveDirectory *directory) {
+    if (open_decode_files(encInfo) == e_failure) {
+        steg_error("ERROR: Unable to open file %s\n", encInfo->stego_image_fname);
+        return e_failure;
+    }
+    if (skip_carrier_header(encInfo) == e_failure || extract_magic(encInfo, magic_string_arg) == e_failure) {
+        steg_error("ERROR: Magic string validation failed.\n");
+        return e_failure;
+    }
+    if (decode_file_extension(encInfo) == e_failure || strcmp(encInfo->ext, ARCHIVE_EXT) != 0) {
+        steg_error("ERROR: The stego file does not hold an archive.\n");
+        return e_failure;
+    }
+
+    int body_size = secret_data_size(encInfo);
+    uint align = encInfo->matrix_p ? encInfo->matrix_p : 1;
+    long needed = get_required_capacity_bits(static_cast<uint8_t>(strlen(magic_string_arg)),
+                                             static_cast<uint8_t>(strlen(ARCHIVE_EXT)), body_size, encInfo->matrix_p);
+    if (body_size < ARCHIVE_HEADER_SIZE || needed < 0 || needed > get_carrier_capacity_bits(&encInfo->carrier)) {
+        steg_error("ERROR: Invalid archive size.\n");
+        return e_failure;
+    }
+    directory->body_start = ftell(encInfo->fptr_stego_image);
+    directory->body_size = (uint)body_size;
+    directory->align = align;
+    directory->entries.clear();
+
+    // Directory size and entry count first, then the whole directory from the start of the body
+    char header[ARCHIVE_HEADER_SIZE + MATRIX_MAX_P];
+    if (extract_payload(encInfo, align_up(ARCHIVE_HEADER_SIZE, align), header) == e_failure) {
+        return e_failure;
+    }
+    uint directory_size = str_to_int(header);
+    uint count = str_to_int(header + 4);
+    if (directory_size < ARCHIVE_HEADER_SIZE || directory_size > directory->body_size ||
+        directory_size > align_up(MAX_DIRECTORY_SIZE, align) || directory_size % align != 0 ||
+        count == 0 || count > MAX_ARCHIVE_ENTRIES) {
+        steg_error("ERROR: Invalid archive directory.\n");
+        return e_failure;
+    }
+    std::vector<char> table(directory_size);
+    if (fseek(encInfo->fptr_stego_image, directory->body_start, SEEK_SET) != 0 ||
+        extract_payload(encInfo, (int)directory_size, table.data()) == e_failure) {
+        return e_failure;
+    }
+
+    uint pos = ARCHIVE_HEADER_SIZE;
+    for (uint i = 0; i < count; ++i) {
+        ArchiveEntry entry;
+        uint name_len = pos < directory_size ? (uint8_t)table[pos] : 0;
+        if (name_len == 0 || pos + 1 + name_len + 8 > directory_size) {
+            steg_error("ERROR: Invalid archive directory.\n");
+            return e_failure;
+        }
+        memcpy(entry.name, &table[pos + 1], name_len);
+        entry.name[name_len] = '\0';
+        pos += 1 + name_len;
+        entry.size = str_to_int(&table[pos]);
+        entry.offset = str_to_int(&table[pos + 4]);
+        pos += 8;
+        // The offset is checked against the body before it is subtracted, so it cannot wrap
+        if (entry.offset < directory_size || entry.offset % align != 0 || entry.offset > directory->body_size ||
+            entry.size > directory->body_size - entry.offset) {
+            steg_error("ERROR: Invalid archive entry %s.\n", entry.name);
+            return e_failure;
+        }
+        directory->entries.push_back(entry);
+    }
+    steg_log("LOG: archive with %u entries\n", count);
+    return e_success;
+}
+
+long get_archive_carrier_offset(const EncodeInfo *encInfo, const ArchiveDirectory *directory, uint body_offset) {
+    long samples = (long)body_offset * 8;
+    if (encInfo->matrix_p) {
+        samples = samples / encInfo->matrix_p * (long)((1u << encInfo->matrix_p) - 1);
+    }
+    return directory->body_start + samples * (long)get_carrier_sample_bytes(encInfo->carrier.type);
+}
+
+int find_archive_entry(const ArchiveDirectory *directory, const char *name) {
+    for (size_t i = 0; i < directory->entries.size(); ++i) {
+        if (strcmp(directory->entries[i].name, name) == 0) {
+            return (int)i;
+        }
+    }
+    return -1;
+}
+
+Status extract_archive_entry(EncodeInfo *encInfo, const ArchiveDirectory *directory, const ArchiveEntry *entry,
+                             FILE *fptr_dest) {
+    if (fseek(encInfo->fptr_stego_image, get_archive_carrier_offset(encInfo, directory, entry->offset), SEEK_SET) != 0) {
+        return e_failure;
+    }
+    std::vector<char> buffer(archive_block_size(directory->align));
+    steg_progress_start(encInfo->control, entry->size);
+    Status status = steg_progress(encInfo->control, 0);
+    for (uint done = 0; done < entry->size && status == e_success;) {
+        uint chunk = entry->size - done < buffer.size() ? entry->size - done : (uint)buffer.size();
+        status = extract_payload(encInfo, (int)chunk, buffer.data());
+        if (status == e_success && fwrite(buffer.data(), 1, chunk, fptr_dest) != chunk) {
+            status = e_failure;
+        }
+        done += chunk;
+        if (status == e_success) {
+            status = steg_progress(encInfo->control, chunk);
+        }
+    }
+    if (status == e_failure) {
+        steg_error("ERROR: Failed to extract %s from the archive.\n", entry->name);
+    }
+    return status;
+}
@@ -0,0 +1,295 @@
+// carrier.cpp
+#include "carrier.h"
+#include "types.h"
+#include "steg_log.h"
+#include <cstdio>
+#include <cstring>
+#include <cstdint>
+#include <vector>
+
+namespace {
+
+// Payload bytes moved per fread/fwrite of the carrier
+const size_t BYTES_PER_READ = 4096;
+
+uint read_le16(const uint8_t *p)
+{
+    return (uint)p[0] | ((uint)p[1] << 8);
+}
+
+uint read_le32(const uint8_t *p)
+{
+    return (uint)p[0] | ((uint)p[1] << 8) | ((uint)p[2] << 16) | ((uint)p[3] << 24);
+}
+
+long file_size(FILE *fptr)
+{
+    fseek(fptr, 0, SEEK_END);
+    long size = ftell(fptr);
+    rewind(fptr);
+    return size;
+}
+
+/* Scans the RIFF chunks of a WAV file for "fmt " and "data"
+ * Output: bits per sample, data chunk offset and size
+ */
+Status parse_wav_chunks(FILE *fptr, uint *bits_per_sample, long *data_offset, long *data_size)
+{
+    uint8_t riff[12];
+    rewind(fptr);
+    if (fread(riff, 1, 12, fptr) != 12 || memcmp(riff, "RIFF", 4) != 0 || memcmp(riff + 8, "WAVE", 4) != 0)
+    {
+        return e_failure;
+    }
+
+    bool have_fmt = false;
+    uint8_t chunk[8];
+    while (fread(chunk, 1, 8, fptr) == 8)
+    {
+        uint chunk_size = read_le32(chunk + 4);
+        long chunk_start = ftell(fptr);
+        if (memcmp(chunk, "fmt ", 4) == 0)
+        {
+            uint8_t fmt[16];
+            if (chunk_size < 16 || fread(fmt, 1, 16, fptr) != 16)
+            {
+                return e_failure;
+            }
+            uint format = read_le16(fmt);
+            if (format != 1 && format != 0xFFFE) // PCM or WAVE_FORMAT_EXTENSIBLE
+            {
+                return e_failure;
+            }
+            *bits_per_sample = read_le16(fmt + 14);
+            have_fmt = true;
+        }
+        else if (memcmp(chunk, "data", 4) == 0)
+        {
+            if (!have_fmt)
+            {
+                return e_failure;
+            }
+            // Streamed WAVs may leave the size unset (0xFFFFFFFF); never go past EOF
+            long available = file_size(fptr) - chunk_start;
+            *data_offset = chunk_start;
+            *data_size = (unsigned long)chunk_size < (unsigned long)available ? (long)chunk_size : available;
+            return e_success;
+        }
+        // Chunks are padded to an even size
+        if (fseek(fptr, chunk_start + chunk_size + (chunk_size & 1), SEEK_SET) != 0)
+        {
+            return e_failure;
+        }
+    }
+    return e_failure;
+}
+
+template <class Carrier>
+Status embed_blocks(const uint8_t *data, size_t size, FILE *fptr_src, FILE *fptr_stego, EmbedVerify *verify)
+{
+    std::vector<uint8_t> buffer(BYTES_PER_READ * 8 * Carrier::sample_bytes);
+    std::vector<uint8_t> readback(verify ? BYTES_PER_READ : 0);
+    for (size_t done = 0; done < size;)
+    {
+        size_t chunk = size - done < BYTES_PER_READ ? size - done : BYTES_PER_READ;
+        size_t bytes = chunk * 8 * Carrier::sample_bytes;
+        if (fread(buffer.data(), 1, bytes, fptr_src) != bytes)
+        {
+            steg_error("ERROR: Failed to read a block from the source carrier.\n");
+            return e_failure;
+        }
+        embed_span<Carrier>(buffer.data(), data + done, chunk);
+        if (verify)
+        {
+            extract_span<Carrier>(buffer.data(), readback.data(), chunk);
+            verify_readback(verify, data + done, readback.data(), chunk);
+        }
+        if (fwrite(buffer.data(), 1, bytes, fptr_stego) != bytes)
+        {
+            steg_error("ERROR: Failed to write a block to the stego carrier.\n");
+            return e_failure;
+        }
+        done += chunk;
+    }
+    return e_success;
+}
+
+template <class Carrier>
+Status extract_blocks(uint8_t *dest, size_t size, FILE *fptr_stego)
+{
+    std::vector<uint8_t> buffer(BYTES_PER_READ * 8 * Carrier::sample_bytes);
+    for (size_t done = 0; done < size;)
+    {
+        size_t chunk = size - done < BYTES_PER_READ ? size - done : BYTES_PER_READ;
+        size_t bytes = chunk * 8 * Carrier::sample_bytes;
+        if (fread(buffer.data(), 1, bytes, fptr_stego) != bytes)
+        {
+            return e_failure;
+        }
+        extract_span<Carrier>(buffer.data(), dest + done, chunk);
+        done += chunk;
+    }
+    return e_success;
+}
+
+// Reflected CRC-32 (zlib polynomial), built once on first use
+struct Crc32Table
+{
+    uint32_t entry[256];
+
+    Crc32Table()
+    {
+        for (uint32_t i = 0; i < 256; ++i)
+        {
+            uint32_t c = i;
+            for (int k = 0; k < 8; ++k)
+            {
+                c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            }
+            entry[i] = c;
+        }
+    }
+};
+
+} // namespace
+
+uint32_t crc32_update(uint32_t crc, const uint8_t *data, size_t size)
+{
+    static const Crc32Table table; // Thread-safe initialization
+    crc = ~crc;
+    for (size_t i = 0; i < size; ++i)
+    {
+        crc = table.entry[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+/* BMP keeps the historical layout: the first 54 bytes are the header and
+ * every byte after them is a sample, so older stego images still decode.
+ */
+Status BmpCarrier::parse_header(FILE *fptr, CarrierInfo *info)
+{
+    char magic[2];
+    rewind(fptr);
+    if (fread(magic, 1, 2, fptr) != 2 || magic[0] != 'B' || magic[1] != 'M')
+    {
+        return e_failure;
+    }
+    info->type = e_carrier_bmp;
+    info->data_offset = 54;
+    info->data_size = file_size(fptr) - 54;
+    return info->data_size > 0 ? e_success : e_failure;
+}
+
+template <uint Bytes>
+Status PcmWavCarrier<Bytes>::parse_header(FILE *fptr, CarrierInfo *info)
+{
+    uint bits_per_sample = 0;
+    long data_offset = 0, data_size = 0;
+    if (parse_wav_chunks(fptr, &bits_per_sample, &data_offset, &data_size) == e_failure ||
+        bits_per_sample != Bytes * 8)
+    {
+        return e_failure;
+    }
+    info->type = Bytes == 1 ? e_carrier_wav_pcm8 : e_carrier_wav_pcm16;
+    info->data_offset = data_offset;
+    info->data_size = data_size;
+    return e_success;
+}
+
+template struct PcmWavCarrier<1>;
+template struct PcmWavCarrier<2>;
+
+Status probe_carrier_header(FILE *fptr, CarrierInfo *info)
+{
+    if (!fptr || !info)
+    {
+        return e_failure;
+    }
+    Status status = (BmpCarrier::parse_header(fptr, info) == e_success ||
+                     PcmWavCarrier<2>::parse_header(fptr, info) == e_success ||
+                     PcmWavCarrier<1>::parse_header(fptr, info) == e_success) ? e_success : e_failure;
+    rewind(fptr);
+    return status;
+}
+
+Status parse_carrier_header(FILE *fptr, CarrierInfo *info)
+{
+    if (probe_carrier_header(fptr, info) == e_success)
+    {
+        return e_success;
+    }
+    if (!fptr || !info)
+    {
+        return e_failure;
+    }
+    steg_error("ERROR: Unsupported carrier, expected a BMP image or an 8/16-bit PCM WAV file.\n");
+    return e_failure;
+}
+
+Status copy_carrier_header(FILE *fptr_src, FILE *fptr_dest, const CarrierInfo *info)
+{
+    std::vector<char> header(info->data_offset);
+    if (fread(header.data(), 1, header.size(), fptr_src) != header.size())
+    {
+        steg_error("ERROR: Unable to read the header!\n");
+        return e_failure;
+    }
+    if (fwrite(header.data(), 1, header.size(), fptr_dest) != header.size())
+    {
+        steg_error("ERROR: Unable to write the header!\n");
+        return e_failure;
+    }
+    steg_log("LOG: successfully copied the carrier header\n");
+    return e_success;
+}
+
+long get_carrier_capacity_bits(const CarrierInfo *info)
+{
+    switch (info->type)
+    {
+    case e_carrier_bmp:       return BmpCarrier::capacity_bits(info);
+    case e_carrier_wav_pcm8:  return PcmWavCarrier<1>::capacity_bits(info);
+    case e_carrier_wav_pcm16: return PcmWavCarrier<2>::capacity_bits(info);
+    }
+    return 0;
+}
+
+uint get_carrier_sample_bytes(CarrierType type)
+{
+    return type == e_carrier_wav_pcm16 ? 2 : 1;
+}
+
+Status embed_to_carrier(CarrierType type, const char *data, int size, FILE *fptr_src, FILE *fptr_stego,
+                        EmbedVerify *verify)
+{
+    if (!data || !fptr_src || !fptr_stego || size <= 0)
+    {
+        steg_error("ERROR: Invalid arguments to embed_to_carrier.\n");
+        return e_failure;
+    }
+    const uint8_t *bytes = (const uint8_t *)data;
+    switch (type)
+    {
+    case e_carrier_bmp:       return embed_blocks<BmpCarrier>(bytes, size, fptr_src, fptr_stego, verify);
+    case e_carrier_wav_pcm8:  return embed_blocks<PcmWavCarrier<1> >(bytes, size, fptr_src, fptr_stego, verify);
+    case e_carrier_wav_pcm16: return embed_blocks<PcmWavCarrier<2> >(bytes, size, fptr_src, fptr_stego, verify);
+    }
+    return e_failure;
+}
+
+Status extract_from_carrier(CarrierType type, int size, FILE *fptr_stego, char *dest)
+{
+    if (!fptr_stego || !dest || size <= 0)
+    {
+        return e_failure;
+    }
+    uint8_t *bytes = (uint8_t *)dest;
+    switch (type)
+    {
+    case e_carrier_bmp:       return extract_blocks<BmpCarrier>(bytes, size, fptr_stego);
+    case e_carrier_wav_pcm8:  return extract_blocks<PcmWavCarrier<1> >(bytes, size, fptr_stego);
+    case e_carrier_wav_pcm16: return extract_blocks<PcmWavCarrier<2> >(bytes, size, fptr_stego);
+    }
+    return e_failure;
+}
@@ -2,6 +2,7 @@
 #include <cstdio>  // For printf if used for logging
 #include <cstdlib> // For malloc
 #include <cstring> // For string functions
+#include <cstdarg>
 
 // void clear_screen_c() { // Remove - not suitable for library
 //     for (int i = 0; i < 100; i++) {
@@ -27,4 +28,137 @@ uint str_to_int(const char* data) // Make data const
 {
  const uint8_t* u_data = (const uint8_t*)data; // Cast for proper unsigned arithmetic
  return (uint)(u_data[3] << 24) | (uint)(u_data[2] << 16) | (uint)(u_data[1] << 8) | (uint)u_data[0];
-}
\ No newline at end of file
+}
+
+void steg_progress_start(StegControl *control, long total)
+{
+    if (!control) return;
+    control->done = 0;
+    control->total = total;
+    control->next_report = 0;
+}
+
+/* Records `bytes` more secret bytes as processed
+ * The callback only runs once every progress_interval bytes (and at the
+ * end), so a caller that has to take a lock to report pays for it rarely.
+ */
+Status steg_progress(StegControl *control, long bytes)
+{
+    if (!control) return e_success;
+    control->done += bytes;
+    if (control->progress && (control->done >= control->next_report || control->done == control->total))
+    {
+        control->progress(control->progress_ctx, control->done, control->total);
+        long interval = control->progress_interval > 0 ? control->progress_interval : STEG_PROGRESS_INTERVAL;
+        control->next_report = control->done + interval;
+    }
+    return steg_check_cancelled(control);
+}
+
+Status steg_check_cancelled(StegControl *control)
+{
+    if (control && control->cancelled && control->cancelled->load())
+    {
+        steg_error("ERROR: Operation cancelled.\n");
+        return e_failure;
+    }
+    return e_success;
+}
+
+const char *secret_file_extension(const char *fname)
+{
+    const char *dot_ptr = strrchr(fname, '.');
+    if (dot_ptr && dot_ptr != fname)
+    {
+        return dot_ptr;
+    }
+    return "";
+}
+
+bool valid_secret_extension(const char *ext)
+{
+    size_t ext_len = strlen(ext);
+    return ext_len > 0 && ext_len <= MAX_EXT_SIZE;
+}
+
+uint8_t pack_ext_size(uint8_t ext_size, uint8_t matrix_p)
+{
+    uint8_t p_bits = matrix_p ? static_cast<uint8_t>((matrix_p - 1) << EXT_MATRIX_SHIFT) : 0;
+    return static_cast<uint8_t>(p_bits | (ext_size & EXT_SIZE_MASK));
+}
+
+Status unpack_ext_size(uint8_t packed, uint8_t matrix_p, uint8_t *ext_size)
+{
+    uint8_t p_bits = packed >> EXT_MATRIX_SHIFT;
+    uint8_t stored_p = p_bits ? static_cast<uint8_t>(p_bits + 1) : 0;
+    if (stored_p != matrix_p)
+    {
+        steg_error("ERROR: The secret was embedded with matrix_p=%u, not %u\n", stored_p, matrix_p);
+        return e_failure;
+    }
+    *ext_size = packed & EXT_SIZE_MASK;
+    return e_success;
+}
+
+namespace {
+
+std::atomic<StegLogFn> log_handler(nullptr);
+std::atomic<void *> log_handler_ctx(nullptr);
+thread_local char last_error[256];
+
+void emit_message(int is_error, const char *format, va_list args)
+{
+    char message[1024];
+    vsnprintf(message, sizeof(message), format, args);
+    if (is_error)
+    {
+        const char *text = strncmp(message, "ERROR: ", 7) == 0 ? message + 7 : message;
+        size_t len = strcspn(text, "\n");
+        if (len >= sizeof(last_error)) len = sizeof(last_error) - 1;
+        memcpy(last_error, text, len);
+        last_error[len] = '\0';
+    }
+    StegLogFn handler = log_handler.load();
+    if (handler)
+    {
+        handler(log_handler_ctx.load(), is_error, message);
+        return;
+    }
+#ifndef STEG_LIBRARY
+    fputs(message, is_error ? stderr : stdout);
+#endif
+}
+
+} // namespace
+
+void steg_set_log_handler(StegLogFn handler, void *ctx)
+{
+    log_handler_ctx.store(ctx);
+    log_handler.store(handler);
+}
+
+void steg_log(const char *format, ...)
+{
+    va_list args;
+    va_start(args, format);
+    emit_message(0, format, args);
+    va_end(args);
+}
+
+void steg_error(const char *format, ...)
+{
+    va_list args;
+    va_start(args, format);
+    emit_message(1, format, args);
+    va_end(args);
+}
+
+const char *steg_last_thread_error(void)
+{
+    return last_error;
+}
+
+void steg_clear_thread_error(void)
+{
+    last_error[0] = '\0';
+}
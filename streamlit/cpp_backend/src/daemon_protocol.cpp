@@ -0,0 +1,224 @@
+// daemon_protocol.cpp
+#include "daemon.h"
+
+#ifndef _WIN32
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+// Linux-only flags; elsewhere SIGPIPE is ignored by the daemon and CLOEXEC is best effort
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+#ifndef MSG_CMSG_CLOEXEC
+#define MSG_CMSG_CLOEXEC 0
+#endif
+#ifndef SOCK_CLOEXEC
+#define SOCK_CLOEXEC 0
+#endif
+
+Status daemon_send(int sock, const void *data, size_t size, const int *fds, int fd_count)
+{
+    const char *bytes = (const char *)data;
+    bool fds_sent = (fd_count == 0);
+    while (size > 0)
+    {
+        struct iovec iov;
+        iov.iov_base = (void *)bytes;
+        iov.iov_len = size;
+
+        struct msghdr msg;
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_iov = &iov;
+        msg.msg_iovlen = 1;
+
+        char control[CMSG_SPACE(sizeof(int) * DAEMON_MAX_FDS)];
+        if (!fds_sent)
+        {
+            if (fd_count < 0 || fd_count > DAEMON_MAX_FDS)
+            {
+                return e_failure;
+            }
+            memset(control, 0, sizeof(control));
+            msg.msg_control = control;
+            msg.msg_controllen = CMSG_SPACE(sizeof(int) * fd_count);
+            struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+            cmsg->cmsg_level = SOL_SOCKET;
+            cmsg->cmsg_type = SCM_RIGHTS;
+            cmsg->cmsg_len = CMSG_LEN(sizeof(int) * fd_count);
+            memcpy(CMSG_DATA(cmsg), fds, sizeof(int) * fd_count);
+        }
+
+        ssize_t sent = sendmsg(sock, &msg, MSG_NOSIGNAL);
+        if (sent < 0)
+        {
+            if (errno == EINTR) continue;
+            return e_failure;
+        }
+        fds_sent = true;
+        bytes += sent;
+        size -= (size_t)sent;
+    }
+    return e_success;
+}
+
+Status daemon_recv(int sock, void *data, size_t size, int *fds, int *fd_count)
+{
+    return daemon_recv_within(sock, data, size, fds, fd_count, NULL);
+}
+
+Status daemon_recv_within(int sock, void *data, size_t size, int *fds, int *fd_count, long *budget_ms)
+{
+    typedef std::chrono::steady_clock Clock;
+    Clock::time_point deadline = Clock::now() + std::chrono::milliseconds(budget_ms ? *budget_ms : 0);
+    char *bytes = (char *)data;
+    if (fd_count) *fd_count = 0;
+    while (size > 0)
+    {
+        if (budget_ms)
+        {
+            // Wait for data only as long as the budget lasts, so a trickling peer cannot stretch it
+            *budget_ms = (long)std::chrono::duration_cast<std::chrono::milliseconds>(deadline - Clock::now()).count();
+            struct pollfd pfd;
+            pfd.fd = sock;
+            pfd.events = POLLIN;
+            pfd.revents = 0;
+            int ready = *budget_ms > 0 ? poll(&pfd, 1, (int)*budget_ms) : 0;
+            if (ready < 0 && errno == EINTR) continue;
+            if (ready <= 0)
+            {
+                *budget_ms = 0;
+                return e_failure; // Timed out
+            }
+        }
+
+        struct iovec iov;
+        iov.iov_base = bytes;
+        iov.iov_len = size;
+
+        struct msghdr msg;
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_iov = &iov;
+        msg.msg_iovlen = 1;
+        char control[CMSG_SPACE(sizeof(int) * DAEMON_MAX_FDS)];
+        if (fds)
+        {
+            msg.msg_control = control;
+            msg.msg_controllen = sizeof(control);
+        }
+
+        ssize_t got = recvmsg(sock, &msg, MSG_CMSG_CLOEXEC);
+        if (got < 0)
+        {
+            if (errno == EINTR) continue;
+            return e_failure;
+        }
+        if (got == 0)
+        {
+            return e_failure; // Peer closed mid-message
+        }
+
+        if (fds)
+        {
+            for (struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg); cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg))
+            {
+                if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS)
+                {
+                    int count = (int)((cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int));
+                    for (int i = 0; i < count; ++i)
+                    {
+                        int fd;
+                        memcpy(&fd, CMSG_DATA(cmsg) + i * sizeof(int), sizeof(int));
+                        if (*fd_count < DAEMON_MAX_FDS)
+                        {
+                            fds[(*fd_count)++] = fd;
+                        }
+                        else
+                        {
+                            close(fd); // More descriptors than any request uses
+                        }
+                    }
+                }
+            }
+            fds = NULL; // Descriptors only ride on the first chunk
+        }
+        bytes += got;
+        size -= (size_t)got;
+    }
+    if (budget_ms)
+    {
+        long left = (long)std::chrono::duration_cast<std::chrono::milliseconds>(deadline - Clock::now()).count();
+        *budget_ms = left > 0 ? left : 0;
+    }
+    return e_success;
+}
+
+int daemon_connect(const char *socket_path)
+{
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (strlen(socket_path) >= sizeof(addr.sun_path))
+    {
+        return -1;
+    }
+    strcpy(addr.sun_path, socket_path);
+
+    int sock = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (sock < 0)
+    {
+        return -1;
+    }
+    if (connect(sock, (struct sockaddr *)&addr, sizeof(addr)) != 0)
+    {
+        close(sock);
+        return -1;
+    }
+    return sock;
+}
+
+Status daemon_call(const char *socket_path, const DaemonRequest *request, const int *fds,
+                   const std::string &magic, const std::vector<char> &inline_data,
+                   DaemonResponse *response, std::vector<char> *payload)
+{
+    int sock = daemon_connect(socket_path);
+    if (sock < 0)
+    {
+        return e_failure;
+    }
+
+    Status status = daemon_send(sock, request, sizeof(*request), fds, (int)request->fd_count);
+    if (status == e_success && !magic.empty())
+    {
+        status = daemon_send(sock, magic.data(), magic.size(), NULL, 0);
+    }
+    if (status == e_success && !inline_data.empty())
+    {
+        status = daemon_send(sock, inline_data.data(), inline_data.size(), NULL, 0);
+    }
+    if (status == e_success)
+    {
+        status = daemon_recv(sock, response, sizeof(*response), NULL, NULL);
+    }
+    if (status == e_success &&
+        (response->protocol_magic != DAEMON_PROTOCOL_MAGIC || response->payload_len > DAEMON_MAX_INLINE))
+    {
+        status = e_failure;
+    }
+    if (status == e_success && payload)
+    {
+        payload->resize(response->payload_len);
+        if (response->payload_len > 0)
+        {
+            status = daemon_recv(sock, payload->data(), payload->size(), NULL, NULL);
+        }
+    }
+    close(sock);
+    return status;
+}
+#endif
@@ -1,5 +1,7 @@
 #include "decode.h"
 #include "common.h" // For str_to_int, etc.
+#include "matrix.h"
+#include "carrier.h"
 #include <cstdio>
 #include <cstring>
 #include <cstdlib> // For malloc/free, though new/delete is more C++ idiomatic for arrays
@@ -18,7 +20,7 @@ Status open_decode_files(EncodeInfo *encInfo)
 uint8_t decode_magic_size(EncodeInfo *encInfo)
 {
     uint8_t magic_s = 0;
-    if (decode_data_from_image(1, encInfo->fptr_stego_image, (char*)&magic_s) == e_failure)
+    if (extract_from_carrier(encInfo->carrier.type, 1, encInfo->fptr_stego_image, (char*)&magic_s) == e_failure)
     {
         return 0; 
     }
@@ -41,7 +43,7 @@ Status extract_magic(EncodeInfo *encInfo, const char *magic_string_arg)
         return e_failure; // Allocation failed
     }
 
-    if (decode_data_from_image(size, encInfo->fptr_stego_image, extracted_magic) == e_failure)
+    if (extract_from_carrier(encInfo->carrier.type, size, encInfo->fptr_stego_image, extracted_magic) == e_failure)
     {
         delete[] extracted_magic; // Clean up
         return e_failure;
@@ -61,7 +63,7 @@ Status extract_magic(EncodeInfo *encInfo, const char *magic_string_arg)
 uint8_t decode_file_extn_size(EncodeInfo *encInfo)
 {
     uint8_t extn_s = 0; 
-    if (decode_data_from_image(1, encInfo->fptr_stego_image, (char*)&extn_s) == e_failure)
+    if (extract_from_carrier(encInfo->carrier.type, 1, encInfo->fptr_stego_image, (char*)&extn_s) == e_failure)
     {
         return 0; 
     }
@@ -70,12 +72,15 @@ uint8_t decode_file_extn_size(EncodeInfo *encInfo)
 
 Status decode_file_extension(EncodeInfo *encInfo)
 {
-    uint8_t extn_size = decode_file_extn_size(encInfo);
+    uint8_t extn_size = 0;
+    if (unpack_ext_size(decode_file_extn_size(encInfo), encInfo->matrix_p, &extn_size) == e_failure) {
+        return e_failure;
+    }
     if (extn_size == 0) { 
         return e_failure; 
     }
     
-    if (extn_size > 20) {  // Max reasonable extension size
+    if (extn_size > MAX_EXT_SIZE) {  // Max reasonable extension size
         return e_failure;
     }
 
@@ -85,7 +90,7 @@ Status decode_file_extension(EncodeInfo *encInfo)
         return e_failure; // Allocation failed
     }
 
-    if (decode_data_from_image(extn_size, encInfo->fptr_stego_image, file_ext) == e_failure)
+    if (extract_from_carrier(encInfo->carrier.type, extn_size, encInfo->fptr_stego_image, file_ext) == e_failure)
     {
         delete[] file_ext; // Clean up
         return e_failure;
@@ -127,7 +132,7 @@ Status open_dest_file(EncodeInfo *encInfo, const char *name)
 int secret_data_size(EncodeInfo *encInfo) 
 {
     char size_bytes[4];
-    if (decode_data_from_image(4, encInfo->fptr_stego_image, size_bytes) == e_failure)
+    if (extract_from_carrier(encInfo->carrier.type, 4, encInfo->fptr_stego_image, size_bytes) == e_failure)
     {
         return -1; 
     }
@@ -142,60 +147,87 @@ Status decode_data_from_image(int size, FILE *fptr_stego_image, char *dest)
         return e_failure;
     }
 
-    char image_byte_buffer;
-    for (int j = 0; j < size; j++) 
+    return extract_from_carrier(e_carrier_bmp, size, fptr_stego_image, dest);
+}
+
+/* Parses the stego carrier header into encInfo->carrier and
+ * positions the stego file at the first sample
+ */
+Status skip_carrier_header(EncodeInfo *encInfo)
+{
+    if (parse_carrier_header(encInfo->fptr_stego_image, &encInfo->carrier) == e_failure)
     {
-        char reconstructed_byte = 0;
-        for (int i = 0; i < 8; i++) 
-        {
-            if (fread(&image_byte_buffer, 1, 1, fptr_stego_image) != 1)
-            {
-                return e_failure;
-            }
-            reconstructed_byte |= ((image_byte_buffer & 1) << i);
-        }
-        dest[j] = reconstructed_byte;
+        return e_failure;
+    }
+    if (fseek(encInfo->fptr_stego_image, encInfo->carrier.data_offset, SEEK_SET) != 0)
+    {
+        return e_failure;
     }
     return e_success;
 }
 
-Status decode_secret_data(EncodeInfo *encInfo)
+Status decode_secret_chunks(EncodeInfo *encInfo, int data_size, int chunk_size, ChunkSinkFn sink, void *sink_ctx)
 {
-    int data_size = secret_data_size(encInfo);
-    if (data_size < 0) { 
+    const int MAX_DECODE_SIZE = 100 * 1024 * 1024; 
+    if (data_size < 0 || data_size > MAX_DECODE_SIZE || chunk_size <= 0 || sink == NULL) {
         return e_failure;
     }
     if (data_size == 0) { 
         return e_success; 
     }
 
-    const int MAX_DECODE_SIZE = 100 * 1024 * 1024; 
-    if (data_size > MAX_DECODE_SIZE) {
-        return e_failure;
+    // Matrix mode decodes whole Hamming blocks, i.e. multiples of matrix_p bytes
+    if (encInfo->matrix_p) {
+        chunk_size -= chunk_size % encInfo->matrix_p;
+        if (chunk_size == 0) {
+            chunk_size = encInfo->matrix_p;
+        }
     }
-
-    // char *secret_data_buf = (char*)malloc(data_size); // C-style
-    char *secret_data_buf = new (std::nothrow) char[data_size]; // C++ style, nothrow version
+    char *secret_data_buf = new (std::nothrow) char[chunk_size]; // C++ style, nothrow version
     if (!secret_data_buf) {
         return e_failure;
     }
 
-    if (decode_data_from_image(data_size, encInfo->fptr_stego_image, secret_data_buf) == e_failure)
+    steg_progress_start(encInfo->control, data_size);
+    Status status = steg_progress(encInfo->control, 0);
+    for (int done = 0; done < data_size && status == e_success;)
     {
-        delete[] secret_data_buf; // free(secret_data_buf) if malloc was used
-        return e_failure;
+        int chunk = data_size - done < chunk_size ? data_size - done : chunk_size;
+        if (encInfo->matrix_p) {
+            status = decode_data_from_image_matrix(chunk, encInfo->matrix_p, encInfo->carrier.type,
+                                                   encInfo->fptr_stego_image, secret_data_buf);
+        } else {
+            status = extract_from_carrier(encInfo->carrier.type, chunk, encInfo->fptr_stego_image, secret_data_buf);
+        }
+        if (status == e_success)
+        {
+            status = sink(sink_ctx, secret_data_buf, chunk);
+        }
+        done += chunk;
+        if (status == e_success)
+        {
+            status = steg_progress(encInfo->control, chunk);
+        }
     }
+    delete[] secret_data_buf;
+    return status;
+}
 
-    if (fwrite(secret_data_buf, 1, data_size, encInfo->fptr_dest_file) != (size_t)data_size)
-    {
-        delete[] secret_data_buf; // free(secret_data_buf)
+static Status write_chunk_to_file(void *ctx, const char *data, int size)
+{
+    return fwrite(data, 1, size, (FILE *)ctx) == (size_t)size ? e_success : e_failure;
+}
+
+Status decode_secret_data(EncodeInfo *encInfo)
+{
+    int data_size = secret_data_size(encInfo);
+    if (data_size < 0) { 
         return e_failure;
     }
-    delete[] secret_data_buf; // free(secret_data_buf)
-    return e_success;
+    // Decoded block by block, same block size as encode_secret_file_data
+    return decode_secret_chunks(encInfo, data_size, STEG_BLOCK_SIZE, write_chunk_to_file, encInfo->fptr_dest_file);
 }
 
-
 Status do_decoding(EncodeInfo *encInfo, const char *magic_string_arg)
 {
     // This function is mostly called by the pybind wrapper (bindings.cpp)
@@ -218,8 +250,7 @@ Status do_decoding(EncodeInfo *encInfo, const char *magic_string_arg)
 
     // For direct call to do_decoding (not current pybind flow):
     /*
-    rewind(encInfo->fptr_stego_image); 
-    if (fseek(encInfo->fptr_stego_image, 54, SEEK_SET) != 0)
+    if (skip_carrier_header(encInfo) == e_failure)
     {
         return e_failure;
     }
@@ -1,5 +1,8 @@
 // encode.cpp
 #include "encode.h"
+#include "matrix.h"
+#include "carrier.h"
+#include <cerrno>
 #include <cstdio>
 #include <cstring>
 #include <cstdint>
@@ -14,30 +17,30 @@ uint get_image_size_for_bmp(FILE *fptr_image) {
     uint width, height;
     fseek(fptr_image, 18, SEEK_SET);
     fread(&width, sizeof(int), 1, fptr_image);
-    printf("width = %u\n", width);
+    steg_log("width = %u\n", width);
     fread(&height, sizeof(int), 1, fptr_image);
-    printf("height = %u\n", height);
+    steg_log("height = %u\n", height);
     return width * height * 3;
 }
 
 Status open_files(EncodeInfo *encInfo) {
     encInfo->fptr_src_image = fopen(encInfo->src_image_fname, "rb");
     if (!encInfo->fptr_src_image) {
-        perror("fopen");
-        fprintf(stderr, "ERROR: Unable to open file %s\n", encInfo->src_image_fname);
+        steg_error("fopen: %s\n", strerror(errno));
+        steg_error("ERROR: Unable to open file %s\n", encInfo->src_image_fname);
         return e_failure;
     }
     encInfo->fptr_secret = fopen(encInfo->secret_fname, "rb");
     if (!encInfo->fptr_secret) {
-        perror("fopen");
-        fprintf(stderr, "ERROR: Unable to open file %s\n", encInfo->secret_fname);
+        steg_error("fopen: %s\n", strerror(errno));
+        steg_error("ERROR: Unable to open file %s\n", encInfo->secret_fname);
         fclose(encInfo->fptr_src_image);
         return e_failure;
     }
     encInfo->fptr_stego_image = fopen(encInfo->stego_image_fname, "wb");
     if (!encInfo->fptr_stego_image) {
-        perror("fopen");
-        fprintf(stderr, "ERROR: Unable to open file %s\n", encInfo->stego_image_fname);
+        steg_error("fopen: %s\n", strerror(errno));
+        steg_error("ERROR: Unable to open file %s\n", encInfo->stego_image_fname);
         fclose(encInfo->fptr_src_image);
         fclose(encInfo->fptr_secret);
         return e_failure;
@@ -45,21 +48,42 @@ Status open_files(EncodeInfo *encInfo) {
     return e_success;
 }
 
+/* Check capacity
+ * Input: encInfo with the carrier, magic_size and ext_size set
+ * Description: every metadata and (plain LSB) secret bit takes one
+ * carrier sample; matrix embedding needs 2^p - 1 samples per p bits
+ */
 Status check_capacity(EncodeInfo *encInfo) {
-    fseek(encInfo->fptr_src_image, 0, SEEK_END);
-    long available = ftell(encInfo->fptr_src_image) - 54 - 1;
-    printf("the size of the image is %ld\n", available);
+    if (!encInfo->carrier_parsed &&
+        parse_carrier_header(encInfo->fptr_src_image, &encInfo->carrier) == e_failure) {
+        return e_failure;
+    }
+    long available = get_carrier_capacity_bits(&encInfo->carrier);
+    steg_log("the capacity of the carrier is %ld bits\n", available);
     int secret_size = get_file_size(encInfo->fptr_secret);
-    printf("the size of the secret is %d\n", secret_size);
-    if (secret_size > (available / 8)) {
-        printf("the secret is too big\n");
+    steg_log("the size of the secret is %d\n", secret_size);
+    long needed = get_required_capacity_bits(encInfo->magic_size, encInfo->ext_size, secret_size, encInfo->matrix_p);
+    if (needed < 0 || needed > available) {
+        steg_log("the secret is too big\n");
         return e_failure;
     }
     rewind(encInfo->fptr_src_image);
-    fprintf(stdout, "LOG: Extracter the file extention and created the destion file\n");
+    steg_log("LOG: Extracter the file extention and created the destion file\n");
     return e_success;
 }
 
+/* Carrier samples needed for the metadata and a secret of secret_size bytes
+ * Output: -1 if matrix_p is not a supported code
+ */
+long get_required_capacity_bits(uint8_t magic_size, uint8_t ext_size, long secret_size, uint8_t matrix_p) {
+    long header_bits = (1L + magic_size + 1 + ext_size + 4) * 8;
+    long needed = secret_size * 8;
+    if (matrix_p) {
+        needed = get_matrix_carrier_size(secret_size, matrix_p);
+    }
+    return needed < 0 ? -1 : header_bits + needed;
+}
+
 uint get_file_size(FILE *fptr) {
     fseek(fptr, 0, SEEK_END);
     uint size = ftell(fptr);
@@ -68,129 +92,177 @@ uint get_file_size(FILE *fptr) {
 }
 
 Status copy_bmp_header(FILE *fptr_src_image, FILE *fptr_dest_image) {
-    char header[54];
-    if (fread(header, 54, 1, fptr_src_image) != 1) {
-        fprintf(stderr, "ERROR: Unable to read the header!\n");
-        return e_failure;
-    }
-    if (fwrite(header, 54, 1, fptr_dest_image) != 1) {
-        fprintf(stderr, "ERROR: Unable to write the header!\n");
-        return e_failure;
-    }
-    fprintf(stdout, "LOG: successfully encoded the header\n");
-    return e_success;
+    CarrierInfo bmp = {e_carrier_bmp, 54, 0};
+    return copy_carrier_header(fptr_src_image, fptr_dest_image, &bmp);
 }
 
 Status encode_magic_string(EncodeInfo *encInfo, const char *magic_string_arg) {
     if (!magic_string_arg) {
-        fprintf(stderr, "ERROR: Magic string argument is null!\n");
+        steg_error("ERROR: Magic string argument is null!\n");
         return e_failure;
     }
-    encInfo->magic_size = static_cast<uint8_t>(strlen(magic_string_arg));
-    if (encInfo->magic_size == 0) {
-        fprintf(stderr, "ERROR: The size of the magic string is invalid!\n");
+    size_t magic_len = strlen(magic_string_arg);
+    if (magic_len == 0 || magic_len >= sizeof(encInfo->MAGIC_STRING)) {
+        steg_error("ERROR: The size of the magic string is invalid!\n");
         return e_failure;
     }
-    strcpy(encInfo->MAGIC_STRING, magic_string_arg);
-    if (encode_data_to_image(reinterpret_cast<const char *>(&encInfo->magic_size), 1,
-                              encInfo->fptr_src_image, encInfo->fptr_stego_image) == e_failure) {
-        fprintf(stderr, "ERROR: Failed to encode the size of the magic string!\n");
+    encInfo->magic_size = static_cast<uint8_t>(magic_len);
+    memcpy(encInfo->MAGIC_STRING, magic_string_arg, magic_len + 1);
+    if (embed_to_carrier(encInfo->carrier.type, reinterpret_cast<const char *>(&encInfo->magic_size), 1,
+                         encInfo->fptr_src_image, encInfo->fptr_stego_image, encInfo->verify) == e_failure) {
+        steg_error("ERROR: Failed to encode the size of the magic string!\n");
         return e_failure;
     }
-    if (encode_data_to_image(magic_string_arg, encInfo->magic_size,
-                              encInfo->fptr_src_image, encInfo->fptr_stego_image) == e_failure) {
-        fprintf(stderr, "ERROR: Failed to encode the magic string!\n");
+    if (embed_to_carrier(encInfo->carrier.type, magic_string_arg, encInfo->magic_size,
+                         encInfo->fptr_src_image, encInfo->fptr_stego_image, encInfo->verify) == e_failure) {
+        steg_error("ERROR: Failed to encode the magic string!\n");
         return e_failure;
     }
-    fprintf(stdout, "LOG: %s successfully encoded the magic string\n", magic_string_arg);
+    steg_log("LOG: %s successfully encoded the magic string\n", magic_string_arg);
     return e_success;
 }
 
 Status encode_secret_file_extn_size(uint8_t ext_size, EncodeInfo *encInfo) {
-    char c = static_cast<char>(ext_size);
-    if (encode_data_to_image(&c, 1, encInfo->fptr_src_image, encInfo->fptr_stego_image) == e_failure) {
-        fprintf(stderr, "ERROR: Failed to encode the size of the extension!\n");
+    if (ext_size > MAX_EXT_SIZE) {
+        steg_error("ERROR: The secret file extension is longer than %d characters\n", MAX_EXT_SIZE);
+        return e_failure;
+    }
+    char c = static_cast<char>(pack_ext_size(ext_size, encInfo->matrix_p));
+    if (embed_to_carrier(encInfo->carrier.type, &c, 1,
+                         encInfo->fptr_src_image, encInfo->fptr_stego_image, encInfo->verify) == e_failure) {
+        steg_error("ERROR: Failed to encode the size of the extension!\n");
         return e_failure;
     }
-    fprintf(stdout, "LOG: successfully encoded the size of the extension\n");
+    steg_log("LOG: successfully encoded the size of the extension\n");
     return e_success;
 }
 
 Status encode_secret_file_extn(const char *file_extn, EncodeInfo *encInfo) {
-    if (encode_data_to_image(file_extn, strlen(file_extn),
-                              encInfo->fptr_src_image, encInfo->fptr_stego_image) == e_failure) {
-        fprintf(stderr, "ERROR: Failed to encode the extension!\n");
+    if (embed_to_carrier(encInfo->carrier.type, file_extn, strlen(file_extn),
+                         encInfo->fptr_src_image, encInfo->fptr_stego_image, encInfo->verify) == e_failure) {
+        steg_error("ERROR: Failed to encode the extension!\n");
         return e_failure;
     }
-    fprintf(stdout, "LOG: successfully encoded the extension\n");
+    steg_log("LOG: successfully encoded the extension\n");
     return e_success;
 }
 
 Status encode_secret_file_size(long file_size, EncodeInfo *encInfo) {
     uint size_uint = static_cast<uint>(file_size);
     char *size_str = int_to_str(size_uint);
-    if (encode_data_to_image(size_str, 4,
-                              encInfo->fptr_src_image, encInfo->fptr_stego_image) == e_failure) {
-        fprintf(stderr, "ERROR: Failed to encode size of the secret file!\n");
+    if (embed_to_carrier(encInfo->carrier.type, size_str, 4,
+                         encInfo->fptr_src_image, encInfo->fptr_stego_image, encInfo->verify) == e_failure) {
+        steg_error("ERROR: Failed to encode size of the secret file!\n");
         return e_failure;
     }
-    fprintf(stdout, "LOG: successfully encoded the size of the secret file\n");
+    steg_log("LOG: successfully encoded the size of the secret file\n");
     return e_success;
 }
 
 Status encode_secret_file_data(EncodeInfo *encInfo) {
     int size = get_file_size(encInfo->fptr_secret);
     if (size <= 0) {
-        fprintf(stderr, "ERROR: Failed to read the size of the secret file!\n");
+        steg_error("ERROR: Failed to read the size of the secret file!\n");
         return e_failure;
     }
-    char *buffer = new char[size];
-    fread(buffer, 1, size, encInfo->fptr_secret);
-    if (encode_data_to_image(buffer, size,
-                              encInfo->fptr_src_image, encInfo->fptr_stego_image) == e_failure) {
-        fprintf(stderr, "ERROR: Failed to encode the secret file!\n");
-        delete[] buffer;
-        return e_failure;
+    // A matrix block must not straddle two calls, so keep blocks a multiple of p bytes
+    int block_size = STEG_BLOCK_SIZE;
+    if (encInfo->matrix_p) {
+        block_size -= block_size % encInfo->matrix_p;
+    }
+    char *buffer = new char[block_size];
+    if (encInfo->verify) {
+        // The checksum covers the secret data only; mismatches also count the metadata
+        encInfo->verify->checksum = 0;
+    }
+    steg_progress_start(encInfo->control, size);
+    Status status = steg_progress(encInfo->control, 0);
+    for (int done = 0; done < size && status == e_success;) {
+        int chunk = size - done < block_size ? size - done : block_size;
+        if (fread(buffer, 1, chunk, encInfo->fptr_secret) != (size_t)chunk) {
+            status = e_failure;
+        } else if (encInfo->matrix_p) {
+            status = encode_data_to_image_matrix(buffer, chunk, encInfo->matrix_p, encInfo->carrier.type,
+                                                 encInfo->fptr_src_image, encInfo->fptr_stego_image, encInfo->verify);
+        } else {
+            status = embed_to_carrier(encInfo->carrier.type, buffer, chunk,
+                                      encInfo->fptr_src_image, encInfo->fptr_stego_image, encInfo->verify);
+        }
+        done += chunk;
+        if (status == e_success) {
+            status = steg_progress(encInfo->control, chunk);
+        }
     }
     delete[] buffer;
-    fprintf(stdout, "LOG: successfully encoded the secret file\n");
+    if (status == e_failure) {
+        steg_error("ERROR: Failed to encode the secret file!\n");
+        return e_failure;
+    }
+    if (encInfo->verify) {
+        if (encInfo->verify->mismatches > 0) {
+            steg_error("ERROR: Verification failed, %ld embedded bytes read back differently!\n",
+                    encInfo->verify->mismatches);
+            return e_failure;
+        }
+        steg_log("LOG: verified %ld embedded bytes, secret CRC-32 %08x\n",
+                encInfo->verify->checked, (unsigned)encInfo->verify->checksum);
+    }
+    steg_log("LOG: successfully encoded the secret file\n");
     return e_success;
 }
 
 Status encode_data_to_image(const char *data, int size,
                             FILE *fptr_src_image, FILE *fptr_stego_image) {
     if (!data || !fptr_src_image || !fptr_stego_image || size <= 0) {
-        fprintf(stderr, "ERROR: Invalid arguments to encode_data_to_image.\n");
+        steg_error("ERROR: Invalid arguments to encode_data_to_image.\n");
         return e_failure;
     }
-    for (int j = 0; j < size; ++j) {
-        unsigned char data_byte = static_cast<unsigned char>(data[j]);
-        char image_byte;
-        for (int i = 0; i < 8; ++i) {
-            if (fread(&image_byte, 1, 1, fptr_src_image) != 1) {
-                fprintf(stderr, "ERROR: Failed to read a byte from source image.\n");
-                return e_failure;
-            }
-            image_byte = (image_byte & ~1) | ((data_byte >> i) & 1);
-            fwrite(&image_byte, 1, 1, fptr_stego_image);
-        }
+    if (embed_to_carrier(e_carrier_bmp, data, size, fptr_src_image, fptr_stego_image) == e_failure) {
+        return e_failure;
     }
     if (ftell(fptr_src_image) != ftell(fptr_stego_image)) {
-        fprintf(stderr, "ERROR: File pointer misalignment after encoding.\n");
+        steg_error("ERROR: File pointer misalignment after encoding.\n");
         return e_failure;
     }
     return e_success;
 }
 
-Status copy_remaining_img_data(FILE *fptr_src, FILE *fptr_dest) {
-    char byte;
-    while (fread(&byte, 1, 1, fptr_src) == 1) {
-        fwrite(&byte, 1, 1, fptr_dest);
+Status copy_remaining_img_data(EncodeInfo *encInfo) {
+    char buffer[4096];
+    size_t got;
+    long since_check = 0;
+    // The tail of a large carrier can take most of the job, so it can be cancelled too
+    while ((got = fread(buffer, 1, sizeof(buffer), encInfo->fptr_src_image)) > 0) {
+        if (fwrite(buffer, 1, got, encInfo->fptr_stego_image) != got) {
+            steg_error("ERROR: Failed to copy the remaining carrier data!\n");
+            return e_failure;
+        }
+        since_check += got;
+        if (since_check >= STEG_BLOCK_SIZE) {
+            since_check = 0;
+            if (steg_check_cancelled(encInfo->control) == e_failure) {
+                return e_failure;
+            }
+        }
+    }
+    if (ferror(encInfo->fptr_src_image)) {
+        steg_error("ERROR: Failed to read the remaining carrier data!\n");
+        return e_failure;
     }
-    fprintf(stdout, "LOG: successfully copied the remaining bits\n");
+    steg_log("LOG: successfully copied the remaining bits\n");
     return e_success;
 }
 
+// Closes the files opened by open_files; the pointers are reset so the caller can't close them twice
+void close_encode_files(EncodeInfo *encInfo) {
+    if (encInfo->fptr_src_image) fclose(encInfo->fptr_src_image);
+    if (encInfo->fptr_stego_image) fclose(encInfo->fptr_stego_image);
+    if (encInfo->fptr_secret) fclose(encInfo->fptr_secret);
+    encInfo->fptr_src_image = NULL;
+    encInfo->fptr_stego_image = NULL;
+    encInfo->fptr_secret = NULL;
+}
+
 Status do_encoding(EncodeInfo *encInfo, const char *magic_string_arg) {
     rewind(encInfo->fptr_src_image);
     rewind(encInfo->fptr_secret);
@@ -261,31 +333,31 @@ Status do_encoding(EncodeInfo *encInfo, const char *magic_string_arg) {
         encInfo->ext_size = 0; 
     }
 
-    if (copy_bmp_header(encInfo->fptr_src_image, encInfo->fptr_stego_image) == e_failure) {
-        fclose(encInfo->fptr_src_image);
-        fclose(encInfo->fptr_stego_image);
-        fclose(encInfo->fptr_secret);
-        fprintf(stderr, "ERROR: copy_bmp_header failed.");
+    encInfo->magic_size = static_cast<uint8_t>(magic_string_arg ? strlen(magic_string_arg) : 0);
+    if (check_capacity(encInfo) == e_failure) {
+        close_encode_files(encInfo);
+        steg_error("ERROR: check_capacity failed.");
+        return e_failure;
+    }
+    if (copy_carrier_header(encInfo->fptr_src_image, encInfo->fptr_stego_image, &encInfo->carrier) == e_failure) {
+        close_encode_files(encInfo);
+        steg_error("ERROR: copy_carrier_header failed.");
         return e_failure;
     }
     if (encode_magic_string(encInfo, magic_string_arg) == e_failure) {
-        fclose(encInfo->fptr_src_image);
-        fclose(encInfo->fptr_stego_image);
-        fclose(encInfo->fptr_secret);
-        fprintf(stderr, "ERROR: encode_magic_string failed.");
+        close_encode_files(encInfo);
+        steg_error("ERROR: encode_magic_string failed.");
         return e_failure;
     }
     if (encode_secret_file_extn_size(encInfo->ext_size, encInfo) == e_failure ||
         encode_secret_file_extn(encInfo->ext, encInfo) == e_failure ||
         encode_secret_file_size(get_file_size(encInfo->fptr_secret), encInfo) == e_failure ||
         encode_secret_file_data(encInfo) == e_failure ||
-        copy_remaining_img_data(encInfo->fptr_src_image, encInfo->fptr_stego_image) == e_failure) {
-        fclose(encInfo->fptr_src_image);
-        fclose(encInfo->fptr_stego_image);
-        fclose(encInfo->fptr_secret);
-        fprintf(stderr, "ERROR: Encoding process failed.");
+        copy_remaining_img_data(encInfo) == e_failure) {
+        close_encode_files(encInfo);
+        steg_error("ERROR: Encoding process failed.");
         return e_failure;
     }
-    fprintf(stdout, "Encoded successfully");
+    steg_log("Encoded successfully");
     return e_success;
 }
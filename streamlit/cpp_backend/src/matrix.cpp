@@ -0,0 +1,237 @@
+// matrix.cpp
+#include "matrix.h"
+#include "steg_log.h"
+#include <cstdio>
+#include <cstring>
+#include <cstdint>
+#include <vector>
+
+namespace {
+
+// Number of Hamming blocks read from the carrier per fread/fwrite
+const uint BLOCKS_PER_READ = 1024;
+
+// Reads `count` (<= 8) payload bits starting at bit `pos`, LSB first like plain LSB
+inline uint get_bits(const uint8_t *data, size_t size, size_t pos, uint count)
+{
+    size_t byte = pos >> 3;
+    uint word = data[byte];
+    if (byte + 1 < size)
+    {
+        word |= (uint)data[byte + 1] << 8;
+    }
+    return (word >> (pos & 7)) & ((1u << count) - 1);
+}
+
+inline void put_bits(uint8_t *dest, size_t size, size_t pos, uint count, uint bits)
+{
+    size_t byte = pos >> 3;
+    uint word = (bits & ((1u << count) - 1)) << (pos & 7);
+    dest[byte] |= (uint8_t)word;
+    if (byte + 1 < size)
+    {
+        dest[byte + 1] |= (uint8_t)(word >> 8);
+    }
+}
+
+/* Embeds the payload bits from bit_pos on into `blocks` consecutive blocks of span
+ * (the last group may be short); returns the bit position after them
+ */
+template <class Carrier, uint P>
+size_t embed_span_blocks(uint8_t *span, size_t blocks, const uint8_t *data, size_t size, size_t bit_pos)
+{
+    typedef HammingKernel<Carrier, P> Kernel;
+    const size_t total_bits = size * 8;
+    for (size_t b = 0; b < blocks; ++b)
+    {
+        size_t left = total_bits - bit_pos;
+        uint count = left < P ? (uint)left : P;
+        Kernel::embed(&span[b * Kernel::block_bytes], get_bits(data, size, bit_pos, count));
+        bit_pos += count;
+    }
+    return bit_pos;
+}
+
+// ORs the groups read from `blocks` blocks of span into dest from bit_pos on; dest must start zeroed
+template <class Carrier, uint P>
+size_t extract_span_blocks(const uint8_t *span, size_t blocks, uint8_t *dest, size_t size, size_t bit_pos)
+{
+    typedef HammingKernel<Carrier, P> Kernel;
+    const size_t total_bits = size * 8;
+    for (size_t b = 0; b < blocks; ++b)
+    {
+        size_t left = total_bits - bit_pos;
+        uint count = left < P ? (uint)left : P;
+        put_bits(dest, size, bit_pos, count, Kernel::extract(&span[b * Kernel::block_bytes]));
+        bit_pos += count;
+    }
+    return bit_pos;
+}
+
+template <class Carrier, uint P>
+Status embed_blocks(const uint8_t *data, size_t size, FILE *fptr_src_image, FILE *fptr_stego_image,
+                    EmbedVerify *verify)
+{
+    typedef HammingKernel<Carrier, P> Kernel;
+    const size_t total_bits = size * 8;
+    const size_t total_blocks = (total_bits + P - 1) / P;
+
+    std::vector<uint8_t> buffer(BLOCKS_PER_READ * Kernel::block_bytes);
+    // BLOCKS_PER_READ * P bits is a whole number of bytes, so every read covers whole payload bytes
+    std::vector<uint8_t> readback(verify ? BLOCKS_PER_READ * P / 8 : 0);
+    size_t bit_pos = 0;
+    for (size_t done = 0; done < total_blocks;)
+    {
+        size_t blocks = total_blocks - done < BLOCKS_PER_READ ? total_blocks - done : BLOCKS_PER_READ;
+        size_t bytes = blocks * Kernel::block_bytes;
+        if (fread(buffer.data(), 1, bytes, fptr_src_image) != bytes)
+        {
+            steg_error("ERROR: Failed to read a block from source image.\n");
+            return e_failure;
+        }
+        size_t first_bit = bit_pos;
+        bit_pos = embed_span_blocks<Carrier, P>(buffer.data(), blocks, data, size, bit_pos);
+        if (verify)
+        {
+            size_t first_byte = first_bit / 8;
+            size_t read_bytes = (bit_pos + 7) / 8 - first_byte;
+            memset(readback.data(), 0, read_bytes);
+            for (size_t b = 0, pos = 0; b < blocks; ++b, pos += P)
+            {
+                size_t left = bit_pos - first_bit - pos;
+                uint count = left < P ? (uint)left : P;
+                put_bits(readback.data(), read_bytes, pos, count, Kernel::extract(&buffer[b * Kernel::block_bytes]));
+            }
+            verify_readback(verify, data + first_byte, readback.data(), read_bytes);
+        }
+        if (fwrite(buffer.data(), 1, bytes, fptr_stego_image) != bytes)
+        {
+            steg_error("ERROR: Failed to write a block to stego image.\n");
+            return e_failure;
+        }
+        done += blocks;
+    }
+    return e_success;
+}
+
+template <class Carrier, uint P>
+Status extract_blocks(uint8_t *dest, size_t size, FILE *fptr_stego_image)
+{
+    typedef HammingKernel<Carrier, P> Kernel;
+    const size_t total_bits = size * 8;
+    const size_t total_blocks = (total_bits + P - 1) / P;
+
+    memset(dest, 0, size);
+    std::vector<uint8_t> buffer(BLOCKS_PER_READ * Kernel::block_bytes);
+    size_t bit_pos = 0;
+    for (size_t done = 0; done < total_blocks;)
+    {
+        size_t blocks = total_blocks - done < BLOCKS_PER_READ ? total_blocks - done : BLOCKS_PER_READ;
+        size_t bytes = blocks * Kernel::block_bytes;
+        if (fread(buffer.data(), 1, bytes, fptr_stego_image) != bytes)
+        {
+            return e_failure;
+        }
+        bit_pos = extract_span_blocks<Carrier, P>(buffer.data(), blocks, dest, size, bit_pos);
+        done += blocks;
+    }
+    return e_success;
+}
+
+template <class Carrier, uint P>
+void embed_span_all(uint8_t *span, const uint8_t *data, size_t size)
+{
+    embed_span_blocks<Carrier, P>(span, (size * 8 + P - 1) / P, data, size, 0);
+}
+
+template <class Carrier, uint P>
+void extract_span_all(const uint8_t *span, uint8_t *dest, size_t size)
+{
+    memset(dest, 0, size);
+    extract_span_blocks<Carrier, P>(span, (size * 8 + P - 1) / P, dest, size, 0);
+}
+
+typedef Status (*EmbedKernel)(const uint8_t *, size_t, FILE *, FILE *, EmbedVerify *);
+typedef Status (*ExtractKernel)(uint8_t *, size_t, FILE *);
+typedef void (*EmbedSpanKernel)(uint8_t *, const uint8_t *, size_t);
+typedef void (*ExtractSpanKernel)(const uint8_t *, uint8_t *, size_t);
+
+#define EMBED_KERNELS(Carrier) { NULL, NULL, \
+    embed_blocks<Carrier, 2>, embed_blocks<Carrier, 3>, embed_blocks<Carrier, 4>, \
+    embed_blocks<Carrier, 5>, embed_blocks<Carrier, 6>, embed_blocks<Carrier, 7>, embed_blocks<Carrier, 8> }
+#define EXTRACT_KERNELS(Carrier) { NULL, NULL, \
+    extract_blocks<Carrier, 2>, extract_blocks<Carrier, 3>, extract_blocks<Carrier, 4>, \
+    extract_blocks<Carrier, 5>, extract_blocks<Carrier, 6>, extract_blocks<Carrier, 7>, extract_blocks<Carrier, 8> }
+#define EMBED_SPAN_KERNELS(Carrier) { NULL, NULL, \
+    embed_span_all<Carrier, 2>, embed_span_all<Carrier, 3>, embed_span_all<Carrier, 4>, \
+    embed_span_all<Carrier, 5>, embed_span_all<Carrier, 6>, embed_span_all<Carrier, 7>, embed_span_all<Carrier, 8> }
+#define EXTRACT_SPAN_KERNELS(Carrier) { NULL, NULL, \
+    extract_span_all<Carrier, 2>, extract_span_all<Carrier, 3>, extract_span_all<Carrier, 4>, \
+    extract_span_all<Carrier, 5>, extract_span_all<Carrier, 6>, extract_span_all<Carrier, 7>, \
+    extract_span_all<Carrier, 8> }
+
+// Indexed by CarrierType, then by p; one specialization per carrier and code
+const EmbedKernel embed_kernels[][MATRIX_MAX_P + 1] = {
+    EMBED_KERNELS(BmpCarrier), EMBED_KERNELS(PcmWavCarrier<1>), EMBED_KERNELS(PcmWavCarrier<2>)
+};
+const ExtractKernel extract_kernels[][MATRIX_MAX_P + 1] = {
+    EXTRACT_KERNELS(BmpCarrier), EXTRACT_KERNELS(PcmWavCarrier<1>), EXTRACT_KERNELS(PcmWavCarrier<2>)
+};
+const EmbedSpanKernel embed_span_kernels[][MATRIX_MAX_P + 1] = {
+    EMBED_SPAN_KERNELS(BmpCarrier), EMBED_SPAN_KERNELS(PcmWavCarrier<1>), EMBED_SPAN_KERNELS(PcmWavCarrier<2>)
+};
+const ExtractSpanKernel extract_span_kernels[][MATRIX_MAX_P + 1] = {
+    EXTRACT_SPAN_KERNELS(BmpCarrier), EXTRACT_SPAN_KERNELS(PcmWavCarrier<1>), EXTRACT_SPAN_KERNELS(PcmWavCarrier<2>)
+};
+
+} // namespace
+
+long get_matrix_carrier_size(long size, uint p)
+{
+    if (p < MATRIX_MIN_P || p > MATRIX_MAX_P)
+    {
+        return -1;
+    }
+    long blocks = (size * 8 + p - 1) / p;
+    return blocks * (long)((1u << p) - 1);
+}
+
+Status encode_data_to_image_matrix(const char *data, int size, uint p, CarrierType carrier,
+                                   FILE *fptr_src_image, FILE *fptr_stego_image, EmbedVerify *verify)
+{
+    if (!data || !fptr_src_image || !fptr_stego_image || size <= 0 || p < MATRIX_MIN_P || p > MATRIX_MAX_P)
+    {
+        steg_error("ERROR: Invalid arguments to encode_data_to_image_matrix.\n");
+        return e_failure;
+    }
+    return embed_kernels[carrier][p]((const uint8_t *)data, (size_t)size, fptr_src_image, fptr_stego_image, verify);
+}
+
+Status decode_data_from_image_matrix(int size, uint p, CarrierType carrier, FILE *fptr_stego_image, char *dest)
+{
+    if (fptr_stego_image == NULL || dest == NULL || size <= 0 || p < MATRIX_MIN_P || p > MATRIX_MAX_P)
+    {
+        return e_failure;
+    }
+    return extract_kernels[carrier][p]((uint8_t *)dest, (size_t)size, fptr_stego_image);
+}
+
+Status embed_span_matrix(CarrierType carrier, uint8_t *span, const char *data, int size, uint p)
+{
+    if (!span || !data || size <= 0 || p < MATRIX_MIN_P || p > MATRIX_MAX_P)
+    {
+        return e_failure;
+    }
+    embed_span_kernels[carrier][p](span, (const uint8_t *)data, (size_t)size);
+    return e_success;
+}
+
+Status extract_span_matrix(CarrierType carrier, const uint8_t *span, int size, uint p, char *dest)
+{
+    if (!span || !dest || size <= 0 || p < MATRIX_MIN_P || p > MATRIX_MAX_P)
+    {
+        return e_failure;
+    }
+    extract_span_kernels[carrier][p](span, (uint8_t *)dest, (size_t)size);
+    return e_success;
+}
@@ -0,0 +1,177 @@
+// pool.cpp
+#include "pool.h"
+#include "encode.h"
+#include "carrier.h"
+
+#ifndef _WIN32
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+// Maps one file and parses its header; fails for anything that is not a carrier
+Status map_carrier(const std::string &path, PooledCarrier *carrier)
+{
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        return e_failure;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || st.st_size <= 0)
+    {
+        close(fd);
+        return e_failure;
+    }
+    size_t size = (size_t)st.st_size;
+    void *data = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED)
+    {
+        return e_failure;
+    }
+
+    memset(carrier, 0, sizeof(*carrier));
+    carrier->data = (const uint8_t *)data;
+    carrier->size = size;
+    FILE *fptr = carrier_pool_open(carrier);
+    Status status = fptr ? probe_carrier_header(fptr, &carrier->info) : e_failure;
+    if (fptr) fclose(fptr);
+    if (status == e_failure)
+    {
+        munmap(data, size);
+        return e_failure;
+    }
+    carrier->capacity_bits = get_carrier_capacity_bits(&carrier->info);
+    carrier->path = strdup(path.c_str());
+    return e_success;
+}
+
+bool by_capacity(const PooledCarrier &a, const PooledCarrier &b)
+{
+    return a.capacity_bits < b.capacity_bits;
+}
+
+} // namespace
+
+Status carrier_pool_load(CarrierPool *pool, const char *dir_path)
+{
+    if (!pool || !dir_path)
+    {
+        return e_failure;
+    }
+    DIR *dir = opendir(dir_path);
+    if (!dir)
+    {
+        steg_error("ERROR: Unable to open the carrier directory %s\n", dir_path);
+        return e_failure;
+    }
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL)
+    {
+        if (entry->d_name[0] == '.')
+        {
+            continue;
+        }
+        PooledCarrier carrier;
+        if (map_carrier(std::string(dir_path) + "/" + entry->d_name, &carrier) == e_success)
+        {
+            pool->carriers.push_back(carrier);
+        }
+        else
+        {
+            steg_log("LOG: skipped %s, not a BMP/WAV carrier\n", entry->d_name);
+        }
+    }
+    closedir(dir);
+
+    std::sort(pool->carriers.begin(), pool->carriers.end(), by_capacity);
+    steg_log("LOG: loaded %zu carriers from %s\n", pool->carriers.size(), dir_path);
+    return pool->carriers.empty() ? e_failure : e_success;
+}
+
+void carrier_pool_free(CarrierPool *pool)
+{
+    for (size_t i = 0; i < pool->carriers.size(); ++i)
+    {
+        munmap((void *)pool->carriers[i].data, pool->carriers[i].size);
+        free(pool->carriers[i].path);
+    }
+    pool->carriers.clear();
+}
+
+const PooledCarrier *carrier_pool_best_fit(const CarrierPool *pool, long needed_bits)
+{
+    PooledCarrier key;
+    key.capacity_bits = needed_bits;
+    std::vector<PooledCarrier>::const_iterator it =
+        std::lower_bound(pool->carriers.begin(), pool->carriers.end(), key, by_capacity);
+    return it == pool->carriers.end() ? NULL : &*it;
+}
+
+FILE *carrier_pool_open(const PooledCarrier *carrier)
+{
+    // fmemopen never writes to a buffer opened for reading, so the mapping can stay read-only
+    return fmemopen((void *)carrier->data, carrier->size, "rb");
+}
+
+Status carrier_pool_encode(const CarrierPool *pool, EncodeInfo *encInfo, const char *magic_string_arg,
+                           const PooledCarrier **used)
+{
+    if (!pool || !encInfo || !encInfo->secret_fname || !encInfo->stego_image_fname || !magic_string_arg)
+    {
+        steg_error("ERROR: Invalid arguments to carrier_pool_encode.\n");
+        return e_failure;
+    }
+    encInfo->fptr_secret = fopen(encInfo->secret_fname, "rb");
+    if (!encInfo->fptr_secret)
+    {
+        steg_error("ERROR: Unable to open file %s\n", encInfo->secret_fname);
+        return e_failure;
+    }
+
+    // Same extension rule as do_encoding
+    const char *ext = secret_file_extension(encInfo->secret_fname);
+    if (!valid_secret_extension(ext))
+    {
+        steg_error("ERROR: The secret file name needs an extension of 1 to %d characters\n", MAX_EXT_SIZE);
+        close_encode_files(encInfo);
+        return e_failure;
+    }
+    long needed = get_required_capacity_bits(static_cast<uint8_t>(strlen(magic_string_arg)),
+                                             static_cast<uint8_t>(strlen(ext)),
+                                             get_file_size(encInfo->fptr_secret), encInfo->matrix_p);
+    const PooledCarrier *carrier = needed < 0 ? NULL : carrier_pool_best_fit(pool, needed);
+    if (!carrier)
+    {
+        steg_error("ERROR: No pooled carrier is large enough for the secret.\n");
+        close_encode_files(encInfo);
+        return e_failure;
+    }
+    steg_log("LOG: selected pooled carrier %s (%ld bits)\n", carrier->path, carrier->capacity_bits);
+
+    encInfo->fptr_src_image = carrier_pool_open(carrier);
+    encInfo->fptr_stego_image = fopen(encInfo->stego_image_fname, "wb");
+    if (!encInfo->fptr_src_image || !encInfo->fptr_stego_image)
+    {
+        steg_error("ERROR: Unable to open file %s\n",
+                   encInfo->fptr_src_image ? encInfo->stego_image_fname : carrier->path);
+        close_encode_files(encInfo);
+        return e_failure;
+    }
+    encInfo->carrier = carrier->info;
+    encInfo->carrier_parsed = 1;
+    if (used) *used = carrier;
+
+    Status status = do_encoding(encInfo, magic_string_arg);
+    close_encode_files(encInfo);
+    return status;
+}
+#endif
@@ -0,0 +1,349 @@
+// steg_api.cpp
+#include "steg_api.h"
+#include "encode.h"
+#include "decode.h"
+#include "matrix.h"
+#include "carrier.h"
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+struct steg_context
+{
+    uint8_t matrix_p;
+    bool verify;
+    StegControl control;
+    std::atomic<bool> cancelled;
+    std::string last_error;
+    uint32_t last_checksum;
+    long last_mismatches;
+    std::string last_output_path;
+};
+
+namespace {
+
+/* The cancel flag is cleared when a job ends rather than when one starts,
+ * so a steg_cancel that arrives just before a job still stops it
+ */
+struct JobScope
+{
+    steg_context *ctx;
+    ~JobScope() { ctx->cancelled.store(false); }
+};
+
+void begin_job(steg_context *ctx)
+{
+    ctx->last_error.clear();
+    ctx->last_checksum = 0;
+    ctx->last_mismatches = 0;
+    ctx->last_output_path.clear();
+    steg_clear_thread_error();
+}
+
+// Records why the job failed: the engine's own message if it reported one
+steg_status fail(steg_context *ctx, steg_status status, const char *fallback)
+{
+    const char *engine_error = steg_last_thread_error();
+    ctx->last_error = engine_error[0] ? engine_error : fallback;
+    return status;
+}
+
+bool valid_magic(const char *magic)
+{
+    size_t len = strlen(magic);
+    return len > 0 && len < sizeof(((EncodeInfo *)0)->MAGIC_STRING);
+}
+
+} // namespace
+
+int steg_api_version(void)
+{
+    return STEG_API_VERSION;
+}
+
+const char *steg_status_string(steg_status status)
+{
+    switch (status)
+    {
+    case STEG_OK:                      return "ok";
+    case STEG_ERR_INVALID_ARGUMENT:    return "invalid argument";
+    case STEG_ERR_IO:                  return "I/O error";
+    case STEG_ERR_UNSUPPORTED_CARRIER: return "unsupported carrier";
+    case STEG_ERR_CAPACITY:            return "secret too large for the carrier";
+    case STEG_ERR_MAGIC:               return "magic string mismatch";
+    case STEG_ERR_VERIFY:              return "verification failed";
+    case STEG_ERR_CANCELLED:           return "cancelled";
+    case STEG_ERR_FAILED:              return "failed";
+    case STEG_ERR_NO_MEMORY:           return "out of memory";
+    case STEG_ERR_BUFFER_TOO_SMALL:    return "output buffer too small";
+    }
+    return "unknown status";
+}
+
+void steg_set_log_callback(steg_log_fn callback, void *user_data)
+{
+    steg_set_log_handler(callback, user_data);
+}
+
+steg_status steg_context_new(steg_context **out)
+{
+    if (!out)
+    {
+        return STEG_ERR_INVALID_ARGUMENT;
+    }
+    steg_context *ctx = new (std::nothrow) steg_context();
+    if (!ctx)
+    {
+        return STEG_ERR_NO_MEMORY;
+    }
+    ctx->matrix_p = 0;
+    ctx->verify = false;
+    memset(&ctx->control, 0, sizeof(ctx->control));
+    ctx->control.cancelled = &ctx->cancelled;
+    ctx->cancelled.store(false);
+    ctx->last_checksum = 0;
+    ctx->last_mismatches = 0;
+    *out = ctx;
+    return STEG_OK;
+}
+
+void steg_context_free(steg_context *ctx)
+{
+    delete ctx;
+}
+
+steg_status steg_set_matrix_p(steg_context *ctx, int matrix_p)
+{
+    if (!ctx || (matrix_p != 0 && (matrix_p < MATRIX_MIN_P || matrix_p > MATRIX_MAX_P)))
+    {
+        return STEG_ERR_INVALID_ARGUMENT;
+    }
+    ctx->matrix_p = static_cast<uint8_t>(matrix_p);
+    return STEG_OK;
+}
+
+steg_status steg_set_verify(steg_context *ctx, int verify)
+{
+    if (!ctx)
+    {
+        return STEG_ERR_INVALID_ARGUMENT;
+    }
+    ctx->verify = verify != 0;
+    return STEG_OK;
+}
+
+steg_status steg_set_progress(steg_context *ctx, steg_progress_fn callback, void *user_data, long interval_bytes)
+{
+    if (!ctx || interval_bytes < 0)
+    {
+        return STEG_ERR_INVALID_ARGUMENT;
+    }
+    ctx->control.progress = callback;
+    ctx->control.progress_ctx = user_data;
+    ctx->control.progress_interval = interval_bytes;
+    return STEG_OK;
+}
+
+void steg_cancel(steg_context *ctx)
+{
+    if (ctx)
+    {
+        ctx->cancelled.store(true);
+    }
+}
+
+steg_status steg_encode(steg_context *ctx, const char *src_path, const char *secret_path,
+                        const char *stego_path, const char *magic)
+{
+    if (!ctx)
+    {
+        return STEG_ERR_INVALID_ARGUMENT;
+    }
+    JobScope job = {ctx};
+    begin_job(ctx);
+    if (ctx->cancelled.load())
+    {
+        return fail(ctx, STEG_ERR_CANCELLED, "Cancelled");
+    }
+    if (!src_path || !secret_path || !stego_path || !magic || !valid_magic(magic))
+    {
+        return fail(ctx, STEG_ERR_INVALID_ARGUMENT, "Missing path or invalid magic string");
+    }
+    if (!valid_secret_extension(secret_file_extension(secret_path)))
+    {
+        std::string message = "The secret file name needs an extension of 1 to " + std::to_string(MAX_EXT_SIZE) +
+                              " characters";
+        return fail(ctx, STEG_ERR_INVALID_ARGUMENT, message.c_str());
+    }
+
+    EncodeInfo encInfo;
+    memset(&encInfo, 0, sizeof(EncodeInfo));
+    encInfo.matrix_p = ctx->matrix_p;
+    encInfo.control = &ctx->control;
+    encInfo.src_image_fname = const_cast<char *>(src_path);
+    encInfo.secret_fname = const_cast<char *>(secret_path);
+    encInfo.stego_image_fname = const_cast<char *>(stego_path);
+    EmbedVerify verify_info;
+    memset(&verify_info, 0, sizeof(verify_info));
+    if (ctx->verify)
+    {
+        encInfo.verify = &verify_info;
+    }
+
+    if (open_files(&encInfo) == e_failure)
+    {
+        return fail(ctx, STEG_ERR_IO, "Unable to open the input or output files");
+    }
+
+    // Check the carrier and its capacity up front so those failures get their own status
+    steg_status status = STEG_OK;
+    if (parse_carrier_header(encInfo.fptr_src_image, &encInfo.carrier) == e_failure)
+    {
+        status = fail(ctx, STEG_ERR_UNSUPPORTED_CARRIER, "Unsupported carrier");
+    }
+    else
+    {
+        long needed = get_required_capacity_bits(static_cast<uint8_t>(strlen(magic)),
+                                                 static_cast<uint8_t>(strlen(secret_file_extension(secret_path))),
+                                                 get_file_size(encInfo.fptr_secret), encInfo.matrix_p);
+        if (needed < 0 || needed > get_carrier_capacity_bits(&encInfo.carrier))
+        {
+            status = fail(ctx, STEG_ERR_CAPACITY, "The secret is too large for the carrier");
+        }
+    }
+    if (status != STEG_OK)
+    {
+        close_encode_files(&encInfo);
+        remove(stego_path);
+        return status;
+    }
+
+    encInfo.carrier_parsed = 1;
+    Status result = do_encoding(&encInfo, magic);
+    close_encode_files(&encInfo);
+    free(encInfo.ext);
+
+    ctx->last_mismatches = verify_info.mismatches;
+    ctx->last_checksum = verify_info.checksum;
+    if (result == e_failure)
+    {
+        remove(stego_path);
+        if (ctx->cancelled.load())
+        {
+            return fail(ctx, STEG_ERR_CANCELLED, "Cancelled");
+        }
+        if (verify_info.mismatches > 0)
+        {
+            return fail(ctx, STEG_ERR_VERIFY, "Verification found mismatched bytes");
+        }
+        return fail(ctx, STEG_ERR_FAILED, "Encoding failed");
+    }
+    return STEG_OK;
+}
+
+steg_status steg_decode(steg_context *ctx, const char *stego_path, const char *output_base,
+                        const char *magic, char *out_path, size_t out_path_size)
+{
+    if (!ctx)
+    {
+        return STEG_ERR_INVALID_ARGUMENT;
+    }
+    JobScope job = {ctx};
+    begin_job(ctx);
+    if (out_path && out_path_size > 0)
+    {
+        out_path[0] = '\0';
+    }
+    if (ctx->cancelled.load())
+    {
+        return fail(ctx, STEG_ERR_CANCELLED, "Cancelled");
+    }
+    if (!stego_path || !output_base || !magic || !valid_magic(magic))
+    {
+        return fail(ctx, STEG_ERR_INVALID_ARGUMENT, "Missing path or invalid magic string");
+    }
+
+    EncodeInfo encInfo;
+    memset(&encInfo, 0, sizeof(EncodeInfo));
+    encInfo.matrix_p = ctx->matrix_p;
+    encInfo.control = &ctx->control;
+    encInfo.stego_image_fname = const_cast<char *>(stego_path);
+
+    if (open_decode_files(&encInfo) == e_failure)
+    {
+        return fail(ctx, STEG_ERR_IO, "Unable to open the stego file");
+    }
+    steg_status status = STEG_OK;
+    if (skip_carrier_header(&encInfo) == e_failure)
+    {
+        status = fail(ctx, STEG_ERR_UNSUPPORTED_CARRIER, "Unsupported carrier");
+    }
+    else if (extract_magic(&encInfo, magic) == e_failure)
+    {
+        status = fail(ctx, STEG_ERR_MAGIC, "The magic string does not match");
+    }
+    else if (decode_file_extension(&encInfo) == e_failure)
+    {
+        status = fail(ctx, STEG_ERR_FAILED, "Failed to decode the file extension");
+    }
+    if (status != STEG_OK)
+    {
+        fclose(encInfo.fptr_stego_image);
+        free(encInfo.ext);
+        return status;
+    }
+
+    std::string path = std::string(output_base) + encInfo.ext;
+    free(encInfo.ext);
+    ctx->last_output_path = path;
+    if (out_path && out_path_size <= path.size())
+    {
+        fclose(encInfo.fptr_stego_image);
+        ctx->last_error = "The output path needs " + std::to_string(path.size() + 1) + " bytes";
+        return STEG_ERR_BUFFER_TOO_SMALL;
+    }
+    if (open_dest_file(&encInfo, path.c_str()) == e_failure)
+    {
+        fclose(encInfo.fptr_stego_image);
+        return fail(ctx, STEG_ERR_IO, "Unable to open the output file");
+    }
+    Status result = decode_secret_data(&encInfo);
+    fclose(encInfo.fptr_stego_image);
+    fclose(encInfo.fptr_dest_file);
+    if (result == e_failure)
+    {
+        remove(path.c_str());
+        if (ctx->cancelled.load())
+        {
+            return fail(ctx, STEG_ERR_CANCELLED, "Cancelled");
+        }
+        return fail(ctx, STEG_ERR_FAILED, "Decoding failed");
+    }
+    if (out_path)
+    {
+        memcpy(out_path, path.c_str(), path.size() + 1);
+    }
+    return STEG_OK;
+}
+
+const char *steg_last_error(const steg_context *ctx)
+{
+    return ctx ? ctx->last_error.c_str() : "";
+}
+
+uint32_t steg_last_checksum(const steg_context *ctx)
+{
+    return ctx ? ctx->last_checksum : 0;
+}
+
+long steg_last_mismatches(const steg_context *ctx)
+{
+    return ctx ? ctx->last_mismatches : 0;
+}
+
+const char *steg_last_output_path(const steg_context *ctx)
+{
+    return ctx ? ctx->last_output_path.c_str() : "";
+}
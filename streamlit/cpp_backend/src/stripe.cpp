@@ -0,0 +1,404 @@
+// stripe.cpp
+#include "stripe.h"
+#include "encode.h"
+#include "decode.h"
+#include "carrier.h"
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+struct StripeJob {
+    const char *src_image_fname;
+    const char *stego_image_fname;
+    const char *secret_data; // Start of this stripe's bytes in the shared secret buffer
+    StripeInfo stripe;
+    Status status;
+    bool stego_opened; // The stego file was created, so it is removed again if the set fails
+};
+
+struct StripeReadJob {
+    const char *stego_image_fname;
+    FILE *fptr_stego_image; // Positioned at the first data byte after the header pass
+    CarrierType carrier;
+    StripeInfo stripe;
+    Status status;
+};
+
+// Bytes of metadata written in front of each stripe's data
+uint stripe_metadata_size(uint8_t magic_size, uint8_t ext_size) {
+    return 1 + magic_size + 1 + ext_size + STRIPE_HEADER_SIZE + 4;
+}
+
+Status encode_uint(uint value, EncodeInfo *encInfo) {
+    char *bytes = int_to_str(value);
+    if (!bytes) {
+        return e_failure;
+    }
+    Status status = embed_to_carrier(encInfo->carrier.type, bytes, 4, encInfo->fptr_src_image, encInfo->fptr_stego_image);
+    free(bytes);
+    return status;
+}
+
+Status decode_uint(EncodeInfo *encInfo, uint *value) {
+    char bytes[4];
+    if (extract_from_carrier(encInfo->carrier.type, 4, encInfo->fptr_stego_image, bytes) == e_failure) {
+        return e_failure;
+    }
+    *value = str_to_int(bytes);
+    return e_success;
+}
+
+void encode_stripe(StripeJob *job, const char *magic_string_arg, const char *ext) {
+    job->status = e_failure;
+
+    EncodeInfo encInfo;
+    memset(&encInfo, 0, sizeof(EncodeInfo));
+    encInfo.fptr_src_image = fopen(job->src_image_fname, "rb");
+    if (!encInfo.fptr_src_image) {
+        steg_error("ERROR: Unable to open file %s\n", job->src_image_fname);
+        return;
+    }
+    encInfo.fptr_stego_image = fopen(job->stego_image_fname, "wb");
+    if (!encInfo.fptr_stego_image) {
+        steg_error("ERROR: Unable to open file %s\n", job->stego_image_fname);
+        fclose(encInfo.fptr_src_image);
+        return;
+    }
+    job->stego_opened = true;
+
+    uint8_t ext_size = static_cast<uint8_t>(strlen(ext));
+    if (parse_carrier_header(encInfo.fptr_src_image, &encInfo.carrier) == e_success &&
+        copy_carrier_header(encInfo.fptr_src_image, encInfo.fptr_stego_image, &encInfo.carrier) == e_success &&
+        encode_magic_string(&encInfo, magic_string_arg) == e_success &&
+        encode_secret_file_extn_size(ext_size, &encInfo) == e_success &&
+        encode_secret_file_extn(ext, &encInfo) == e_success &&
+        encode_stripe_header(&job->stripe, &encInfo) == e_success &&
+        encode_uint(job->stripe.length, &encInfo) == e_success &&
+        (job->stripe.length == 0 ||
+         embed_to_carrier(encInfo.carrier.type, job->secret_data, job->stripe.length,
+                          encInfo.fptr_src_image, encInfo.fptr_stego_image) == e_success) &&
+        copy_remaining_img_data(&encInfo) == e_success) {
+        job->status = e_success;
+    } else {
+        steg_error("ERROR: Failed to encode stripe %u into %s\n", job->stripe.index, job->stego_image_fname);
+    }
+
+    fclose(encInfo.fptr_src_image);
+    if (fclose(encInfo.fptr_stego_image) != 0) {
+        job->status = e_failure;
+    }
+}
+
+void read_stripe_header(StripeReadJob *job, const char *magic_string_arg, std::string *ext) {
+    job->status = e_failure;
+
+    EncodeInfo encInfo;
+    memset(&encInfo, 0, sizeof(EncodeInfo));
+    encInfo.stego_image_fname = const_cast<char *>(job->stego_image_fname);
+    if (open_decode_files(&encInfo) == e_failure) {
+        steg_error("ERROR: Unable to open file %s\n", job->stego_image_fname);
+        return;
+    }
+    job->fptr_stego_image = encInfo.fptr_stego_image;
+
+    if (skip_carrier_header(&encInfo) == e_failure ||
+        extract_magic(&encInfo, magic_string_arg) == e_failure) {
+        steg_error("ERROR: Magic string validation failed for %s\n", job->stego_image_fname);
+        return;
+    }
+    if (decode_file_extension(&encInfo) == e_failure) {
+        steg_error("ERROR: Failed to decode the extension of %s\n", job->stego_image_fname);
+        return;
+    }
+    ext->assign(encInfo.ext);
+    free(encInfo.ext);
+    job->carrier = encInfo.carrier.type;
+
+    if (decode_stripe_header(&encInfo, &job->stripe) == e_failure ||
+        decode_uint(&encInfo, &job->stripe.length) == e_failure) {
+        steg_error("ERROR: Failed to decode the stripe header of %s\n", job->stego_image_fname);
+        return;
+    }
+    job->status = e_success;
+}
+
+void decode_stripe(StripeReadJob *job, const char *output_path) {
+    job->status = e_failure;
+
+    FILE *fptr_dest = fopen(output_path, "r+b");
+    if (!fptr_dest) {
+        steg_error("ERROR: Unable to open file %s\n", output_path);
+        return;
+    }
+    if (fseek(fptr_dest, job->stripe.offset, SEEK_SET) != 0) {
+        fclose(fptr_dest);
+        return;
+    }
+
+    const uint CHUNK_SIZE = 64 * 1024;
+    std::vector<char> buffer(CHUNK_SIZE);
+    uint remaining = job->stripe.length;
+    while (remaining > 0) {
+        uint chunk = remaining < CHUNK_SIZE ? remaining : CHUNK_SIZE;
+        if (extract_from_carrier(job->carrier, chunk, job->fptr_stego_image, buffer.data()) == e_failure ||
+            fwrite(buffer.data(), 1, chunk, fptr_dest) != chunk) {
+            steg_error("ERROR: Failed to decode stripe %u from %s\n", job->stripe.index, job->stego_image_fname);
+            fclose(fptr_dest);
+            return;
+        }
+        remaining -= chunk;
+    }
+
+    if (fclose(fptr_dest) == 0) {
+        job->status = e_success;
+    }
+}
+
+} // namespace
+
+Status encode_stripe_header(const StripeInfo *stripe, EncodeInfo *encInfo) {
+    if (encode_uint(stripe->index, encInfo) == e_failure ||
+        encode_uint(stripe->count, encInfo) == e_failure ||
+        encode_uint(stripe->offset, encInfo) == e_failure ||
+        encode_uint(stripe->total_size, encInfo) == e_failure) {
+        steg_error("ERROR: Failed to encode the stripe header!\n");
+        return e_failure;
+    }
+    return e_success;
+}
+
+Status decode_stripe_header(EncodeInfo *encInfo, StripeInfo *stripe) {
+    if (decode_uint(encInfo, &stripe->index) == e_failure ||
+        decode_uint(encInfo, &stripe->count) == e_failure ||
+        decode_uint(encInfo, &stripe->offset) == e_failure ||
+        decode_uint(encInfo, &stripe->total_size) == e_failure) {
+        return e_failure;
+    }
+    return e_success;
+}
+
+/* Number of secret bytes a carrier can hold as one stripe
+ * Every secret byte takes 8 carrier samples, after the carrier header
+ * and the metadata written in front of the stripe.
+ */
+uint get_stripe_capacity(FILE *fptr_src_image, uint8_t magic_size, uint8_t ext_size) {
+    CarrierInfo carrier;
+    if (parse_carrier_header(fptr_src_image, &carrier) == e_failure) {
+        return 0;
+    }
+    long available = get_carrier_capacity_bits(&carrier);
+    long capacity = available / 8 - static_cast<long>(stripe_metadata_size(magic_size, ext_size));
+    return capacity > 0 ? static_cast<uint>(capacity) : 0;
+}
+
+Status do_striped_encoding(const char **src_image_fnames, const char **stego_image_fnames, int count,
+                           const char *secret_fname, const char *magic_string_arg) {
+    if (!src_image_fnames || !stego_image_fnames || !secret_fname || !magic_string_arg ||
+        count <= 0 || count > MAX_STRIPES) {
+        steg_error("ERROR: Invalid arguments to do_striped_encoding.\n");
+        return e_failure;
+    }
+    size_t magic_len = strlen(magic_string_arg);
+    const char *ext = secret_file_extension(secret_fname);
+    if (magic_len == 0 || magic_len >= sizeof(((EncodeInfo *)0)->MAGIC_STRING) || !valid_secret_extension(ext)) {
+        steg_error("ERROR: Invalid magic string or secret file extension.\n");
+        return e_failure;
+    }
+
+    // Read the secret once; every stripe encodes from its own slice of this buffer
+    FILE *fptr_secret = fopen(secret_fname, "rb");
+    if (!fptr_secret) {
+        steg_error("ERROR: Unable to open file %s\n", secret_fname);
+        return e_failure;
+    }
+    uint total_size = get_file_size(fptr_secret);
+    std::vector<char> secret(total_size);
+    if (total_size == 0 || fread(secret.data(), 1, total_size, fptr_secret) != total_size) {
+        steg_error("ERROR: Failed to read the secret file!\n");
+        fclose(fptr_secret);
+        return e_failure;
+    }
+    fclose(fptr_secret);
+
+    // Share the secret out in proportion to each carrier's capacity
+    std::vector<uint> capacity(count);
+    uint64_t total_capacity = 0;
+    for (int i = 0; i < count; ++i) {
+        FILE *fptr_src = fopen(src_image_fnames[i], "rb");
+        if (!fptr_src) {
+            steg_error("ERROR: Unable to open file %s\n", src_image_fnames[i]);
+            return e_failure;
+        }
+        capacity[i] = get_stripe_capacity(fptr_src, static_cast<uint8_t>(magic_len), static_cast<uint8_t>(strlen(ext)));
+        fclose(fptr_src);
+        total_capacity += capacity[i];
+    }
+    steg_log("the size of the secret is %u, the striped capacity is %llu\n", total_size,
+           static_cast<unsigned long long>(total_capacity));
+    if (total_size > total_capacity) {
+        steg_error("ERROR: The secret is too big for the carriers: %u bytes, %llu available\n", total_size,
+                   static_cast<unsigned long long>(total_capacity));
+        return e_failure;
+    }
+
+    std::vector<StripeJob> jobs(count);
+    uint assigned = 0;
+    for (int i = 0; i < count; ++i) {
+        jobs[i].stripe.length = static_cast<uint>(static_cast<uint64_t>(total_size) * capacity[i] / total_capacity);
+        assigned += jobs[i].stripe.length;
+    }
+    // Hand the bytes lost to rounding to carriers with room to spare
+    for (int i = 0; assigned < total_size; i = (i + 1) % count) {
+        if (jobs[i].stripe.length < capacity[i]) {
+            jobs[i].stripe.length++;
+            assigned++;
+        }
+    }
+
+    uint offset = 0;
+    for (int i = 0; i < count; ++i) {
+        jobs[i].src_image_fname = src_image_fnames[i];
+        jobs[i].stego_image_fname = stego_image_fnames[i];
+        jobs[i].secret_data = secret.data() + offset;
+        jobs[i].stripe.index = i;
+        jobs[i].stripe.count = count;
+        jobs[i].stripe.offset = offset;
+        jobs[i].stripe.total_size = total_size;
+        jobs[i].status = e_failure;
+        jobs[i].stego_opened = false;
+        offset += jobs[i].stripe.length;
+    }
+
+    std::vector<std::thread> workers;
+    for (int i = 0; i < count; ++i) {
+        workers.emplace_back(encode_stripe, &jobs[i], magic_string_arg, ext);
+    }
+    for (auto &worker : workers) {
+        worker.join();
+    }
+
+    // The stripes report their errors on their own threads; report the set failing on this one
+    int failed = 0;
+    for (int i = 0; i < count; ++i) {
+        failed += jobs[i].status == e_failure;
+    }
+    if (failed > 0) {
+        steg_error("ERROR: Failed to encode %d of %d stripes\n", failed, count);
+        for (int i = 0; i < count; ++i) {
+            if (jobs[i].stego_opened) {
+                remove(stego_image_fnames[i]); // A partial set cannot be decoded
+            }
+        }
+        return e_failure;
+    }
+    steg_log("LOG: successfully encoded %d stripes\n", count);
+    return e_success;
+}
+
+Status do_striped_decoding(const char **stego_image_fnames, int count, const char *magic_string_arg,
+                           const char *output_base_path, char **output_path) {
+    if (!stego_image_fnames || !magic_string_arg || !output_base_path || !output_path ||
+        count <= 0 || count > MAX_STRIPES) {
+        steg_error("ERROR: Invalid arguments to do_striped_decoding.\n");
+        return e_failure;
+    }
+    *output_path = NULL;
+
+    std::vector<StripeReadJob> jobs(count);
+    std::vector<std::string> exts(count);
+    for (int i = 0; i < count; ++i) {
+        jobs[i].stego_image_fname = stego_image_fnames[i];
+        jobs[i].fptr_stego_image = NULL;
+    }
+
+    std::vector<std::thread> workers;
+    for (int i = 0; i < count; ++i) {
+        workers.emplace_back(read_stripe_header, &jobs[i], magic_string_arg, &exts[i]);
+    }
+    for (auto &worker : workers) {
+        worker.join();
+    }
+    workers.clear();
+
+    // The set is complete when every index 0..count-1 appears exactly once and
+    // the stripes tile the secret without gaps or overlaps
+    std::vector<StripeReadJob *> by_index(count, NULL);
+    Status status = e_success;
+    for (int i = 0; i < count && status == e_success; ++i) {
+        const StripeInfo &stripe = jobs[i].stripe;
+        if (jobs[i].status == e_failure) {
+            status = e_failure;
+        } else if (stripe.count != (uint)count || stripe.index >= (uint)count || by_index[stripe.index]) {
+            steg_error("ERROR: %s does not belong to a complete set of %d stripes\n",
+                    jobs[i].stego_image_fname, count);
+            status = e_failure;
+        } else if (stripe.total_size != jobs[0].stripe.total_size || exts[i] != exts[0]) {
+            steg_error("ERROR: %s belongs to a different striped secret\n", jobs[i].stego_image_fname);
+            status = e_failure;
+        } else {
+            by_index[stripe.index] = &jobs[i];
+        }
+    }
+    uint expected_offset = 0;
+    for (int i = 0; i < count && status == e_success; ++i) {
+        if (by_index[i]->stripe.offset != expected_offset) {
+            steg_error("ERROR: Stripe %d does not start where stripe %d ends\n", i, i - 1);
+            status = e_failure;
+        }
+        expected_offset += by_index[i]->stripe.length;
+    }
+    if (status == e_success && expected_offset != jobs[0].stripe.total_size) {
+        steg_error("ERROR: Stripes do not add up to the secret size\n");
+        status = e_failure;
+    }
+
+    std::string final_output_path = std::string(output_base_path) + (count > 0 ? exts[0] : "");
+    if (status == e_success) {
+        // Create the output up front; every worker then writes its own region
+        FILE *fptr_dest = fopen(final_output_path.c_str(), "wb");
+        if (!fptr_dest) {
+            steg_error("ERROR: Unable to open file %s\n", final_output_path.c_str());
+            status = e_failure;
+        } else {
+            fclose(fptr_dest);
+            for (int i = 0; i < count; ++i) {
+                workers.emplace_back(decode_stripe, &jobs[i], final_output_path.c_str());
+            }
+            for (auto &worker : workers) {
+                worker.join();
+            }
+            for (int i = 0; i < count; ++i) {
+                if (jobs[i].status == e_failure) {
+                    status = e_failure;
+                }
+            }
+            if (status == e_failure) {
+                remove(final_output_path.c_str());
+            }
+        }
+    }
+
+    for (int i = 0; i < count; ++i) {
+        if (jobs[i].fptr_stego_image) fclose(jobs[i].fptr_stego_image);
+    }
+    if (status == e_failure) {
+        return e_failure;
+    }
+
+#ifdef _MSC_VER
+    *output_path = _strdup(final_output_path.c_str());
+#else
+    *output_path = strdup(final_output_path.c_str());
+#endif
+    if (!*output_path) {
+        return e_failure;
+    }
+    steg_log("LOG: successfully decoded %d stripes\n", count);
+    return e_success;
+}
@@ -0,0 +1,606 @@
+// video.cpp
+#include "video.h"
+#include "encode.h"
+#include "decode.h"
+#include "matrix.h"
+#include "carrier.h"
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+// Every plane byte is a sample, so frames reuse the BMP kernels
+const CarrierType FRAME_SAMPLES = e_carrier_bmp;
+typedef BmpCarrier FrameCarrier;
+
+enum FrameState { e_frame_free, e_frame_read, e_frame_done };
+
+struct VideoFrame {
+    long index;
+    char line[MAX_Y4M_LINE]; // FRAME line as read, '\n' included
+    size_t line_size;
+    std::vector<uint8_t> samples;
+    std::vector<char> chunk; // Secret bytes carried by the frame
+    uint offset;             // Offset of chunk in the secret, from the frame header
+};
+
+// Same little-endian layout as int_to_str, without the allocation
+void store_uint(char *dest, uint value) {
+    for (int i = 0; i < 4; ++i) {
+        dest[i] = (char)((value >> (8 * i)) & 0xFF);
+    }
+}
+
+// Bytes of metadata at the start of frame 0
+long video_metadata_size(uint8_t magic_size, uint8_t ext_size) {
+    return 1 + magic_size + 1 + ext_size + 4 + 4;
+}
+
+// Carrier samples taken by size secret bytes
+long payload_samples(long size, uint8_t matrix_p) {
+    return matrix_p ? get_matrix_carrier_size(size, matrix_p) : size * 8;
+}
+
+// Reads one header line; false unless it ends with '\n' within MAX_Y4M_LINE bytes
+bool read_y4m_line(FILE *fptr, char *line, size_t *size) {
+    if (!fgets(line, MAX_Y4M_LINE, fptr)) {
+        return false;
+    }
+    *size = strlen(line);
+    return *size > 0 && line[*size - 1] == '\n';
+}
+
+bool is_frame_line(const char *line) {
+    size_t tag = strlen(Y4M_FRAME_TAG);
+    return strncmp(line, Y4M_FRAME_TAG, tag) == 0 && (line[tag] == '\n' || line[tag] == ' ');
+}
+
+// Sample bytes of a frame for the C (colour space) tag, -1 if it is not an 8-bit format
+long y4m_frame_size(uint width, uint height, const char *colorspace) {
+    long luma = (long)width * height;
+    long half_width = (width + 1) / 2;
+    if (strcmp(colorspace, "420") == 0 || strcmp(colorspace, "420jpeg") == 0 ||
+        strcmp(colorspace, "420paldv") == 0 || strcmp(colorspace, "420mpeg2") == 0) {
+        return luma + 2 * half_width * ((height + 1) / 2);
+    }
+    if (strcmp(colorspace, "411") == 0) {
+        return luma + 2 * (long)((width + 3) / 4) * height;
+    }
+    if (strcmp(colorspace, "422") == 0) {
+        return luma + 2 * half_width * height;
+    }
+    if (strcmp(colorspace, "444") == 0) {
+        return 3 * luma;
+    }
+    if (strcmp(colorspace, "444alpha") == 0) {
+        return 4 * luma;
+    }
+    if (strcmp(colorspace, "mono") == 0) {
+        return luma;
+    }
+    return -1;
+}
+
+Status read_y4m_frame(FILE *fptr, const Y4mInfo *info, VideoFrame *frame) {
+    if (!read_y4m_line(fptr, frame->line, &frame->line_size) || !is_frame_line(frame->line)) {
+        steg_error("ERROR: Malformed FRAME line before frame %ld\n", frame->index);
+        return e_failure;
+    }
+    frame->samples.resize(info->frame_size);
+    if (fread(frame->samples.data(), 1, info->frame_size, fptr) != (size_t)info->frame_size) {
+        steg_error("ERROR: Frame %ld is truncated\n", frame->index);
+        return e_failure;
+    }
+    return e_success;
+}
+
+/* Runs frames [0, frame_count) from fptr_in through Job:
+ *   reader thread:  reads the frame, then job->read (e.g. the frame's secret chunk)
+ *   worker threads: job->process, on any frame, in any order
+ *   calling thread: job->write, strictly in frame order
+ * Frame i lives in slot i % slots; the reader waits for the writer to free a
+ * slot, so at most `slots` frames are in memory and both ends stay sequential.
+ */
+template <class Job>
+Status run_frame_pipeline(Job *job, FILE *fptr_in, long frame_count, const Y4mInfo *info,
+                          const VideoOptions *options) {
+    uint workers = options && options->workers ? options->workers : std::thread::hardware_concurrency();
+    if (workers == 0) {
+        workers = 1;
+    }
+    long slots = options && options->max_in_flight ? options->max_in_flight : 2 * workers;
+    if (slots > frame_count) {
+        slots = frame_count;
+    }
+    if (workers > slots) {
+        workers = (uint)slots;
+    }
+
+    std::vector<VideoFrame> frames(slots);
+    std::vector<FrameState> state(slots, e_frame_free);
+    std::deque<long> ready; // Frames read and waiting for a worker
+    std::mutex mutex;
+    std::condition_variable changed; // Any slot changed state, or the pipeline failed
+    bool reading_done = false;
+    bool failed = false;
+
+    std::thread reader([&] {
+        for (long i = 0; i < frame_count; ++i) {
+            VideoFrame *frame = &frames[i % slots];
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                changed.wait(lock, [&] { return state[i % slots] == e_frame_free || failed; });
+                if (failed) {
+                    break;
+                }
+            }
+            frame->index = i;
+            Status status = read_y4m_frame(fptr_in, info, frame);
+            if (status == e_success) {
+                status = job->read(frame);
+            }
+            std::lock_guard<std::mutex> lock(mutex);
+            if (status == e_failure) {
+                failed = true;
+                changed.notify_all();
+                break;
+            }
+            state[i % slots] = e_frame_read;
+            ready.push_back(i);
+            changed.notify_all();
+        }
+        std::lock_guard<std::mutex> lock(mutex);
+        reading_done = true;
+        changed.notify_all();
+    });
+
+    std::vector<std::thread> pool;
+    for (uint w = 0; w < workers; ++w) {
+        pool.emplace_back([&] {
+            for (;;) {
+                long i;
+                {
+                    std::unique_lock<std::mutex> lock(mutex);
+                    changed.wait(lock, [&] { return !ready.empty() || reading_done || failed; });
+                    if (failed || ready.empty()) {
+                        return;
+                    }
+                    i = ready.front();
+                    ready.pop_front();
+                }
+                Status status = job->process(&frames[i % slots]);
+                std::lock_guard<std::mutex> lock(mutex);
+                if (status == e_failure) {
+                    failed = true;
+                } else {
+                    state[i % slots] = e_frame_done;
+                }
+                changed.notify_all();
+            }
+        });
+    }
+
+    for (long i = 0; i < frame_count; ++i) {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            changed.wait(lock, [&] { return state[i % slots] == e_frame_done || failed; });
+            if (failed) {
+                break;
+            }
+        }
+        Status status = job->write(&frames[i % slots]);
+        std::lock_guard<std::mutex> lock(mutex);
+        if (status == e_failure) {
+            failed = true;
+        } else {
+            state[i % slots] = e_frame_free;
+        }
+        changed.notify_all();
+    }
+
+    reader.join();
+    for (auto &worker : pool) {
+        worker.join();
+    }
+    return failed ? e_failure : e_success;
+}
+
+// Embeds one chunk per frame; the reader thread reads the chunks from the secret in order
+struct VideoEmbedJob {
+    FILE *fptr_secret;
+    FILE *fptr_stego;
+    std::vector<char> metadata;
+    long chunk_size; // Secret bytes per frame; the last used frame carries what is left
+    long secret_size;
+    uint8_t matrix_p;
+    StegControl *control;
+
+    Status read(VideoFrame *frame) {
+        long left = secret_size - frame->index * chunk_size;
+        frame->chunk.resize(left < chunk_size ? left : chunk_size);
+        if (!frame->chunk.empty() &&
+            fread(frame->chunk.data(), 1, frame->chunk.size(), fptr_secret) != frame->chunk.size()) {
+            steg_error("ERROR: The secret file changed while it was being encoded!\n");
+            return e_failure;
+        }
+        return e_success;
+    }
+
+    Status process(VideoFrame *frame) {
+        uint8_t *samples = frame->samples.data();
+        if (frame->index == 0) {
+            embed_span<FrameCarrier>(samples, (const uint8_t *)metadata.data(), metadata.size());
+            samples += metadata.size() * 8;
+        }
+        char header[VIDEO_FRAME_HEADER_SIZE];
+        store_uint(header, (uint)(frame->index * chunk_size));
+        store_uint(header + 4, (uint)frame->chunk.size());
+        embed_span<FrameCarrier>(samples, (const uint8_t *)header, VIDEO_FRAME_HEADER_SIZE);
+        samples += VIDEO_FRAME_HEADER_SIZE * 8;
+        if (frame->chunk.empty()) {
+            return e_success;
+        }
+        if (matrix_p) {
+            return embed_span_matrix(FRAME_SAMPLES, samples, frame->chunk.data(), (int)frame->chunk.size(), matrix_p);
+        }
+        embed_span<FrameCarrier>(samples, (const uint8_t *)frame->chunk.data(), frame->chunk.size());
+        return e_success;
+    }
+
+    Status write(VideoFrame *frame) {
+        if (fwrite(frame->line, 1, frame->line_size, fptr_stego) != frame->line_size ||
+            fwrite(frame->samples.data(), 1, frame->samples.size(), fptr_stego) != frame->samples.size()) {
+            steg_error("ERROR: Failed to write frame %ld of the stego video\n", frame->index);
+            return e_failure;
+        }
+        return steg_progress(control, (long)frame->chunk.size());
+    }
+};
+
+// Extracts the chunk of every used frame; the writer checks that they follow each other
+struct VideoExtractJob {
+    FILE *fptr_dest;
+    long metadata_samples; // Samples in front of frame 0's header
+    long frame_size;
+    long secret_size;
+    long written;
+    uint8_t matrix_p;
+    StegControl *control;
+
+    Status read(VideoFrame *) {
+        return e_success;
+    }
+
+    Status process(VideoFrame *frame) {
+        const uint8_t *samples = frame->samples.data();
+        long used = frame->index == 0 ? metadata_samples : 0;
+        char header[VIDEO_FRAME_HEADER_SIZE];
+        extract_span<FrameCarrier>(samples + used, (uint8_t *)header, VIDEO_FRAME_HEADER_SIZE);
+        used += VIDEO_FRAME_HEADER_SIZE * 8;
+        frame->offset = str_to_int(header);
+        long length = str_to_int(header + 4);
+        if (length > secret_size || used + payload_samples(length, matrix_p) > frame_size) {
+            steg_error("ERROR: Corrupt header in frame %ld\n", frame->index);
+            return e_failure;
+        }
+        frame->chunk.resize(length);
+        if (length == 0) {
+            return e_success;
+        }
+        if (matrix_p) {
+            return extract_span_matrix(FRAME_SAMPLES, samples + used, (int)length, matrix_p, frame->chunk.data());
+        }
+        extract_span<FrameCarrier>(samples + used, (uint8_t *)frame->chunk.data(), length);
+        return e_success;
+    }
+
+    Status write(VideoFrame *frame) {
+        if ((long)frame->offset != written || written + (long)frame->chunk.size() > secret_size) {
+            steg_error("ERROR: Frame %ld does not continue the secret where the previous frame ends\n",
+                       frame->index);
+            return e_failure;
+        }
+        if (!frame->chunk.empty() &&
+            fwrite(frame->chunk.data(), 1, frame->chunk.size(), fptr_dest) != frame->chunk.size()) {
+            steg_error("ERROR: Failed to write the decoded secret\n");
+            return e_failure;
+        }
+        written += (long)frame->chunk.size();
+        return steg_progress(control, (long)frame->chunk.size());
+    }
+};
+
+// Reads `size` metadata bytes of frame 0, starting `*pos` bytes into the metadata
+Status extract_metadata(const VideoFrame *frame, long *pos, void *dest, long size) {
+    if ((*pos + size) * 8 > (long)frame->samples.size()) {
+        return e_failure;
+    }
+    extract_span<FrameCarrier>(frame->samples.data() + *pos * 8, (uint8_t *)dest, size);
+    *pos += size;
+    return e_success;
+}
+
+} // namespace
+
+Status parse_y4m_header(FILE *fptr, Y4mInfo *info) {
+    char line[MAX_Y4M_LINE];
+    size_t size;
+    memset(info, 0, sizeof(Y4mInfo));
+    rewind(fptr);
+    if (!read_y4m_line(fptr, line, &size) || strncmp(line, Y4M_SIGNATURE, strlen(Y4M_SIGNATURE)) != 0) {
+        steg_error("ERROR: Not a YUV4MPEG2 video\n");
+        return e_failure;
+    }
+
+    // Tags are separated by single spaces; only W, H and C matter here
+    const char *colorspace = "420jpeg";
+    line[size - 1] = '\0';
+    for (char *token = line + strlen(Y4M_SIGNATURE); token;) {
+        char *next = strchr(token, ' ');
+        if (next) {
+            *next++ = '\0';
+        }
+        if (token[0] == 'W') {
+            info->width = (uint)strtoul(token + 1, NULL, 10);
+        } else if (token[0] == 'H') {
+            info->height = (uint)strtoul(token + 1, NULL, 10);
+        } else if (token[0] == 'C') {
+            colorspace = token + 1;
+        }
+        token = next;
+    }
+    if (info->width == 0 || info->height == 0 || info->width > MAX_Y4M_DIMENSION ||
+        info->height > MAX_Y4M_DIMENSION) {
+        steg_error("ERROR: Invalid Y4M frame size %ux%u\n", info->width, info->height);
+        return e_failure;
+    }
+    info->frame_size = y4m_frame_size(info->width, info->height, colorspace);
+    if (info->frame_size < 0) {
+        steg_error("ERROR: Unsupported Y4M colour space C%s, only 8-bit samples are supported\n", colorspace);
+        return e_failure;
+    }
+    info->header_size = (long)size;
+
+    // Count the frames by hopping from one FRAME line to the next
+    fseek(fptr, 0, SEEK_END);
+    long file_size = ftell(fptr);
+    long pos = info->header_size;
+    while (pos < file_size) {
+        if (fseek(fptr, pos, SEEK_SET) != 0 || !read_y4m_line(fptr, line, &size) || !is_frame_line(line)) {
+            steg_error("ERROR: Malformed FRAME line before frame %ld\n", info->frame_count);
+            return e_failure;
+        }
+        pos += (long)size + info->frame_size;
+        if (pos > file_size) {
+            steg_error("ERROR: Frame %ld is truncated\n", info->frame_count);
+            return e_failure;
+        }
+        ++info->frame_count;
+    }
+    if (info->frame_count == 0) {
+        steg_error("ERROR: The video has no frames\n");
+        return e_failure;
+    }
+    fseek(fptr, info->header_size, SEEK_SET);
+    return e_success;
+}
+
+long get_video_frame_capacity(const Y4mInfo *info, uint8_t magic_size, uint8_t ext_size, uint8_t matrix_p) {
+    // Every frame is sized like frame 0, which also carries the metadata
+    long samples = info->frame_size - (video_metadata_size(magic_size, ext_size) + VIDEO_FRAME_HEADER_SIZE) * 8;
+    if (samples <= 0) {
+        return 0;
+    }
+    if (!matrix_p) {
+        return samples / 8;
+    }
+    // Whole Hamming blocks, so that every chunk but the last is a multiple of matrix_p bytes
+    long bytes = samples / ((1L << matrix_p) - 1) * matrix_p / 8;
+    return bytes - bytes % matrix_p;
+}
+
+Status do_video_encoding(EncodeInfo *encInfo, const char *magic_string_arg, const VideoOptions *options) {
+    if (!encInfo || !magic_string_arg || strlen(magic_string_arg) == 0 ||
+        strlen(magic_string_arg) >= sizeof(encInfo->MAGIC_STRING)) {
+        steg_error("ERROR: Invalid arguments to do_video_encoding.\n");
+        return e_failure;
+    }
+    const char *ext = secret_file_extension(encInfo->secret_fname);
+    if (!valid_secret_extension(ext)) {
+        steg_error("ERROR: The secret file name needs an extension of 1 to %d characters\n", MAX_EXT_SIZE);
+        return e_failure;
+    }
+    uint8_t magic_size = static_cast<uint8_t>(strlen(magic_string_arg));
+    uint8_t ext_size = static_cast<uint8_t>(strlen(ext));
+
+    encInfo->fptr_src_image = fopen(encInfo->src_image_fname, "rb");
+    encInfo->fptr_secret = encInfo->fptr_src_image ? fopen(encInfo->secret_fname, "rb") : NULL;
+    encInfo->fptr_stego_image = encInfo->fptr_secret ? fopen(encInfo->stego_image_fname, "wb") : NULL;
+    if (!encInfo->fptr_stego_image) {
+        steg_error("ERROR: Unable to open the source video, secret or stego video\n");
+        close_encode_files(encInfo);
+        return e_failure;
+    }
+    Y4mInfo video;
+    if (parse_y4m_header(encInfo->fptr_src_image, &video) == e_failure) {
+        close_encode_files(encInfo);
+        remove(encInfo->stego_image_fname);
+        return e_failure;
+    }
+
+    // The secret is spread evenly: every used frame carries chunk_size bytes but the last
+    long secret_size = get_file_size(encInfo->fptr_secret);
+    long align = encInfo->matrix_p ? encInfo->matrix_p : 1;
+    long chunk_size = (secret_size + video.frame_count - 1) / video.frame_count;
+    chunk_size = chunk_size == 0 ? align : (chunk_size + align - 1) / align * align;
+    long frames_used = secret_size ? (secret_size + chunk_size - 1) / chunk_size : 1;
+    long frame_capacity = get_video_frame_capacity(&video, magic_size, ext_size, encInfo->matrix_p);
+    steg_log("the video has %ld frames of %ux%u, each can carry %ld bytes\n", video.frame_count,
+             video.width, video.height, frame_capacity);
+    steg_log("the size of the secret is %ld, %ld bytes in each of %ld frames\n", secret_size, chunk_size,
+             frames_used);
+    if (secret_size > INT32_MAX || chunk_size > frame_capacity) {
+        steg_error("ERROR: The secret is too big for the video: %ld bytes per frame needed, %ld available\n",
+                   chunk_size, frame_capacity);
+        close_encode_files(encInfo);
+        remove(encInfo->stego_image_fname);
+        return e_failure;
+    }
+
+    VideoEmbedJob job;
+    job.fptr_secret = encInfo->fptr_secret;
+    job.fptr_stego = encInfo->fptr_stego_image;
+    job.chunk_size = chunk_size;
+    job.secret_size = secret_size;
+    job.matrix_p = encInfo->matrix_p;
+    job.control = encInfo->control;
+    job.metadata.push_back(static_cast<char>(magic_size));
+    job.metadata.insert(job.metadata.end(), magic_string_arg, magic_string_arg + magic_size);
+    job.metadata.push_back(static_cast<char>(pack_ext_size(ext_size, encInfo->matrix_p)));
+    job.metadata.insert(job.metadata.end(), ext, ext + ext_size);
+    job.metadata.resize(job.metadata.size() + 8);
+    store_uint(&job.metadata[job.metadata.size() - 8], (uint)secret_size);
+    store_uint(&job.metadata[job.metadata.size() - 4], (uint)frames_used);
+
+    // The stream header is copied unchanged, the frames after the last used one too
+    char header[MAX_Y4M_LINE];
+    rewind(encInfo->fptr_src_image);
+    Status status = e_success;
+    if (fread(header, 1, video.header_size, encInfo->fptr_src_image) != (size_t)video.header_size ||
+        fwrite(header, 1, video.header_size, encInfo->fptr_stego_image) != (size_t)video.header_size) {
+        steg_error("ERROR: Failed to copy the Y4M stream header\n");
+        status = e_failure;
+    }
+    steg_progress_start(encInfo->control, secret_size);
+    if (status == e_success) {
+        status = steg_progress(encInfo->control, 0);
+    }
+    if (status == e_success) {
+        status = run_frame_pipeline(&job, encInfo->fptr_src_image, frames_used, &video, options);
+    }
+    if (status == e_success) {
+        status = copy_remaining_img_data(encInfo);
+    }
+    close_encode_files(encInfo);
+    if (status == e_failure) {
+        steg_error("ERROR: Failed to encode the secret into the video.\n");
+        remove(encInfo->stego_image_fname); // No partial stego video is left behind
+        return e_failure;
+    }
+    steg_log("LOG: encoded %ld bytes into %ld frames of %s\n", secret_size, frames_used, encInfo->stego_image_fname);
+    return e_success;
+}
+
+Status do_video_decoding(EncodeInfo *encInfo, const char *magic_string_arg, const char *output_base_path,
+                         char **output_path, const VideoOptions *options) {
+    if (!encInfo || !magic_string_arg || !output_base_path || !output_path || strlen(magic_string_arg) == 0 ||
+        strlen(magic_string_arg) >= sizeof(encInfo->MAGIC_STRING)) {
+        steg_error("ERROR: Invalid arguments to do_video_decoding.\n");
+        return e_failure;
+    }
+    *output_path = NULL;
+    encInfo->fptr_stego_image = fopen(encInfo->stego_image_fname, "rb");
+    if (!encInfo->fptr_stego_image) {
+        steg_error("ERROR: Unable to open file %s\n", encInfo->stego_image_fname);
+        return e_failure;
+    }
+    Y4mInfo video;
+    VideoFrame first;
+    first.index = 0;
+    if (parse_y4m_header(encInfo->fptr_stego_image, &video) == e_failure ||
+        read_y4m_frame(encInfo->fptr_stego_image, &video, &first) == e_failure) {
+        fclose(encInfo->fptr_stego_image);
+        encInfo->fptr_stego_image = NULL;
+        return e_failure;
+    }
+
+    // The metadata of frame 0 is read up front: the extension names the output file
+    long pos = 0;
+    uint8_t magic_size = 0, ext_size = 0;
+    char magic[sizeof(encInfo->MAGIC_STRING)];
+    char ext[UINT8_MAX + 1];
+    char sizes[8] = {0};
+    Status status = e_success;
+    if (extract_metadata(&first, &pos, &magic_size, 1) == e_failure || magic_size != strlen(magic_string_arg) ||
+        extract_metadata(&first, &pos, magic, magic_size) == e_failure ||
+        memcmp(magic, magic_string_arg, magic_size) != 0) {
+        steg_error("ERROR: Magic string mismatch\n");
+        status = e_failure;
+    } else if (extract_metadata(&first, &pos, &ext_size, 1) == e_success &&
+               unpack_ext_size(ext_size, encInfo->matrix_p, &ext_size) == e_failure) {
+        status = e_failure; // The wrong matrix_p, already reported
+    } else if (extract_metadata(&first, &pos, ext, ext_size) == e_failure ||
+               extract_metadata(&first, &pos, sizes, 8) == e_failure) {
+        steg_error("ERROR: Failed to decode the video metadata\n");
+        status = e_failure;
+    }
+    ext[status == e_success ? ext_size : 0] = '\0';
+    long secret_size = str_to_int(sizes);
+    long frames_used = str_to_int(sizes + 4);
+    if (status == e_success && (frames_used < 1 || frames_used > video.frame_count || secret_size > INT32_MAX ||
+        secret_size > frames_used * get_video_frame_capacity(&video, magic_size, ext_size, encInfo->matrix_p))) {
+        steg_error("ERROR: The video metadata does not match this video\n");
+        status = e_failure;
+    }
+    if (status == e_failure) {
+        fclose(encInfo->fptr_stego_image);
+        encInfo->fptr_stego_image = NULL;
+        return e_failure;
+    }
+
+    std::string final_output_path = std::string(output_base_path) + ext;
+    if (open_dest_file(encInfo, final_output_path.c_str()) == e_failure) {
+        steg_error("ERROR: Unable to open file %s\n", final_output_path.c_str());
+        fclose(encInfo->fptr_stego_image);
+        encInfo->fptr_stego_image = NULL;
+        return e_failure;
+    }
+
+    VideoExtractJob job;
+    job.fptr_dest = encInfo->fptr_dest_file;
+    job.metadata_samples = pos * 8;
+    job.frame_size = video.frame_size;
+    job.secret_size = secret_size;
+    job.written = 0;
+    job.matrix_p = encInfo->matrix_p;
+    job.control = encInfo->control;
+    steg_progress_start(encInfo->control, secret_size);
+    status = steg_progress(encInfo->control, 0);
+    if (status == e_success) {
+        fseek(encInfo->fptr_stego_image, video.header_size, SEEK_SET);
+        status = run_frame_pipeline(&job, encInfo->fptr_stego_image, frames_used, &video, options);
+    }
+    if (status == e_success && job.written != secret_size) {
+        steg_error("ERROR: The frames carry %ld of the %ld secret bytes\n", job.written, secret_size);
+        status = e_failure;
+    }
+    if (fclose(encInfo->fptr_dest_file) != 0) {
+        status = e_failure;
+    }
+    fclose(encInfo->fptr_stego_image);
+    encInfo->fptr_dest_file = NULL;
+    encInfo->fptr_stego_image = NULL;
+    if (status == e_failure) {
+        remove(final_output_path.c_str());
+        return e_failure;
+    }
+
+#ifdef _MSC_VER
+    *output_path = _strdup(final_output_path.c_str());
+#else
+    *output_path = strdup(final_output_path.c_str());
+#endif
+    if (!*output_path) {
+        return e_failure;
+    }
+    steg_log("LOG: decoded %ld bytes from %ld frames\n", secret_size, frames_used);
+    return e_success;
+}
@@ -9,15 +9,24 @@ if platform.system() == "Windows":
     # MSVC default release build already includes /O2 (optimization)
     # Define _CRT_SECURE_NO_WARNINGS to suppress warnings about "unsafe" functions
     cpp_args.append('/D_CRT_SECURE_NO_WARNINGS')
+    link_args = []
 else:
-    cpp_args = ['-std=c++14', '-O3', '-Wall', '-fPIC'] # GCC/Clang
+    cpp_args = ['-std=c++14', '-O3', '-Wall', '-fPIC', '-pthread'] # GCC/Clang
+    link_args = ['-pthread'] # std::thread is used for striped encoding/decoding
 
 # All source files for the extension
 sources = [
     'streamlit/cpp_backend/bindings.cpp',
     'streamlit/cpp_backend/src/common.cpp',
     'streamlit/cpp_backend/src/encode.cpp',
-    'streamlit/cpp_backend/src/decode.cpp'
+    'streamlit/cpp_backend/src/decode.cpp',
+    'streamlit/cpp_backend/src/stripe.cpp',
+    'streamlit/cpp_backend/src/matrix.cpp',
+    'streamlit/cpp_backend/src/carrier.cpp',
+    'streamlit/cpp_backend/src/pool.cpp',
+    'streamlit/cpp_backend/src/archive.cpp',
+    'streamlit/cpp_backend/src/video.cpp',
+    'streamlit/cpp_backend/src/daemon_protocol.cpp' # stegd client, empty on Windows
 ]
 
 steganography_module = Extension(
@@ -29,6 +38,7 @@ steganography_module = Extension(
     ],
     language='c++',
     extra_compile_args=cpp_args,
+    extra_link_args=link_args,
 )
 
 setup(
@@ -88,10 +88,10 @@ with enc_col:
         c1, c2 = st.columns(2)
         with c1:
             src_image = st.file_uploader(
-                "Source Image (BMP)",
-                type=["bmp"],
+                "Source Carrier (BMP/WAV)",
+                type=["bmp", "wav"],
                 key="enc_src",
-                help="Select the BMP image you want to hide data in."
+                help="Select the BMP image or PCM WAV file you want to hide data in."
             )
         with c2:
             secret_file = st.file_uploader(
@@ -113,9 +113,9 @@ with enc_col:
                 secret_path = get_unique_filename(UPLOAD_DIR, secret_file.name)
                 with open(secret_path, 'wb') as f: f.write(secret_file.getbuffer())
 
-                base_stego_name, _ = os.path.splitext(src_image.name)
-                # Ensure the stego image name is also BMP
-                stego_image_name_with_ext = f"stego_{base_stego_name}.bmp"
+                base_stego_name, src_ext = os.path.splitext(src_image.name)
+                # The stego file keeps the carrier's format (BMP or WAV)
+                stego_image_name_with_ext = f"stego_{base_stego_name}{src_ext.lower()}"
                 stego_path = get_unique_filename(OUTPUT_DIR, stego_image_name_with_ext)
 
                 with st.spinner("Encoding... This may take a moment."):
@@ -155,7 +155,7 @@ with enc_col:
                     coln, cold, colu = st.columns([4, 1, 2])
                     coln.write(fn)
                     with open(p, 'rb') as f_download:
-                        cold.download_button("📥", f_download, file_name=fn, mime="image/bmp", key=f"dl_enc_{fn}", help="Download stego image")
+                        cold.download_button("📥", f_download, file_name=fn, mime="audio/wav" if fn.lower().endswith(".wav") else "image/bmp", key=f"dl_enc_{fn}", help="Download stego image")
                     if colu.button("→ Use in Decode", key=f"use_{fn}", help="Send this file to the decode panel"):
                         st.session_state['decode_file'] = p
                         st.rerun()
@@ -183,10 +183,10 @@ with dec_col:
                 st.rerun()
         else:
             upload = st.file_uploader(
-                "Stego Image (BMP)",
-                type=["bmp"],
+                "Stego Carrier (BMP/WAV)",
+                type=["bmp", "wav"],
                 key="dec_src", # Unique key
-                help="Upload the BMP image containing hidden data."
+                help="Upload the BMP image or WAV file containing hidden data."
             )
             if upload:
                 stego_path_decode_input = get_unique_filename(UPLOAD_DIR, upload.name)